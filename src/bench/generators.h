@@ -0,0 +1,120 @@
+#ifndef CONFIG_BENCH_GENERATORS_H
+#define CONFIG_BENCH_GENERATORS_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <config/external/json.hpp>
+#include <config/registry.h>
+#include <config/validator/builder.h>
+
+using namespace nlohmann;
+
+// synthetic settings with a fixed seed, the same index always gives the same name, type and value
+// names are nested three levels deep like "section12.group3.key_4711"
+class CConfigGenerator {
+    uint64_t m_Seed;
+
+public:
+    enum EKind {
+        KIND_INT,
+        KIND_FLOAT,
+        KIND_BOOL,
+        KIND_STRING,
+        NUM_KINDS,
+    };
+
+    explicit CConfigGenerator(uint64_t Seed = 42) : m_Seed(Seed) {
+    }
+
+    static std::string Name(size_t Index) {
+        return "section" + std::to_string(Index % 97) + ".group" + std::to_string(Index / 97 % 31) +
+               ".key_" + std::to_string(Index);
+    }
+
+    static EKind Kind(size_t Index) { return static_cast<EKind>(Index % NUM_KINDS); }
+
+    // value as it appears in a generated file, Round lets files differ between reloads
+    json Value(size_t Index, uint64_t Round = 0) const {
+        std::mt19937_64 rng(m_Seed ^ (Index * 0x9e3779b97f4a7c15ull) ^ Round);
+        switch (Kind(Index)) {
+            case KIND_INT:
+                return static_cast<int>(rng() % 100000);
+            case KIND_FLOAT:
+                return static_cast<float>(rng() % 100000) / 100.0f;
+            case KIND_BOOL:
+                return (rng() & 1) != 0;
+            default: {
+                std::string value(8 + rng() % 56, ' ');
+                for (char &c: value)
+                    c = static_cast<char>('a' + rng() % 26);
+                return value;
+            }
+        }
+    }
+
+    // registers the settings in [First, Last), validators are the ranged shortcuts real code uses
+    static void Register(CConfigRegistry &Registry, size_t First, size_t Last) {
+        for (size_t i = First; i < Last; ++i) {
+            const std::string name = Name(i);
+            switch (Kind(i)) {
+                case KIND_INT:
+                    Registry.Register<int>(CConfigVariable<int>(name, 0, Validators::IntRanged(0, 100000)));
+                    break;
+                case KIND_FLOAT:
+                    Registry.Register<float>(CConfigVariable<float>(name, 0.0f, Validators::FloatRanged(0.0f, 1000.0f)));
+                    break;
+                case KIND_BOOL:
+                    Registry.Register<bool>(CConfigVariable<bool>(name, false, Validators::Boolean()));
+                    break;
+                default:
+                    Registry.Register<std::string>(CConfigVariable<std::string>(name, "default", Validators::StringNonEmpty()));
+                    break;
+            }
+        }
+    }
+
+    // nested document with the first Count settings
+    json Document(size_t Count, uint64_t Round = 0) const {
+        json root = json::object();
+        for (size_t i = 0; i < Count; ++i) {
+            const std::string name = Name(i);
+            json *pCurrent = &root;
+            size_t start = 0;
+            for (size_t dot = name.find('.'); dot != std::string::npos; dot = name.find('.', start)) {
+                pCurrent = &(*pCurrent)[name.substr(start, dot - start)];
+                start = dot + 1;
+            }
+            (*pCurrent)[name.substr(start)] = Value(i, Round);
+        }
+        return root;
+    }
+
+    // random integer texts for the validator benchmarks, some of them out of range or malformed
+    std::vector<std::string> IntegerTexts(size_t Count) const {
+        std::mt19937_64 rng(m_Seed);
+        std::vector<std::string> texts;
+        texts.reserve(Count);
+        for (size_t i = 0; i < Count; ++i) {
+            switch (rng() % 16) {
+                case 0:
+                    texts.push_back(" " + std::to_string(rng() % 100000) + " ");
+                    break;
+                case 1:
+                    texts.push_back(std::to_string(100000 + rng() % 100000));
+                    break;
+                case 2:
+                    texts.push_back("12a");
+                    break;
+                default:
+                    texts.push_back(std::to_string(rng() % 100000));
+                    break;
+            }
+        }
+        return texts;
+    }
+};
+
+#endif // CONFIG_BENCH_GENERATORS_H
@@ -0,0 +1,269 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <config/registry.h>
+#include <config/validator/builder.h>
+#include <config/validator/stages.h>
+
+#include "generators.h"
+
+// allocation counting
+
+static std::atomic<uint64_t> s_Allocations = 0;
+// lets the threaded benchmarks count their readers without the writer
+static thread_local uint64_t s_ThreadAllocations = 0;
+
+// gcc pairs the inlined malloc in operator new with the free in operator delete and flags it
+// as mismatched, they are exactly the pair the replacements are meant to be
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t Size) {
+    s_Allocations.fetch_add(1, std::memory_order_relaxed);
+    ++s_ThreadAllocations;
+    if (void *p = std::malloc(Size ? Size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t Size) { return operator new(Size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+static long PeakRssKb() {
+#if defined(_WIN32)
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+// runner
+
+class CBench {
+    std::string_view m_Filter;
+
+public:
+    explicit CBench(std::string_view Filter) : m_Filter(Filter) {
+    }
+
+    bool Enabled(std::string_view Name) const { return m_Filter.empty() || Name.find(m_Filter) != std::string_view::npos; }
+
+    static void Report(std::string_view Name, uint64_t Ops, std::chrono::nanoseconds Elapsed, uint64_t Allocations) {
+        std::printf("%-48.*s %14.1f ns/op %10.2f allocs/op %8ld KiB peak\n", static_cast<int>(Name.size()), Name.data(),
+                    static_cast<double>(Elapsed.count()) / static_cast<double>(Ops),
+                    static_cast<double>(Allocations) / static_cast<double>(Ops), PeakRssKb());
+        std::fflush(stdout);
+    }
+
+    // Func(Ops) performs Ops operations
+    template<typename F>
+    void Run(std::string_view Name, uint64_t Ops, F &&Func) const {
+        if (!Enabled(Name))
+            return;
+
+        const uint64_t allocations = s_Allocations.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        Func(Ops);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        Report(Name, Ops, elapsed, s_Allocations.load(std::memory_order_relaxed) - allocations);
+    }
+};
+
+template<typename T>
+static void DoNotOptimize(const T &Value) {
+#if defined(_MSC_VER)
+    static volatile const void *s_pSink;
+    s_pSink = &Value;
+#else
+    asm volatile("" : : "r,m"(Value) : "memory");
+#endif
+}
+
+// benchmarks
+
+// Readers threads read one setting through Read while a writer keeps changing it, reports the reader latency
+template<typename F>
+static void ContendedReads(const CBench &Bench, std::string_view Name, F &&Read) {
+    for (const unsigned readers: {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        const std::string name = std::string(Name) + "/readers:" + std::to_string(readers);
+        if (!Bench.Enabled(name))
+            continue;
+
+        static constexpr uint64_t s_OpsPerReader = 2'000'000;
+        std::atomic<bool> stop = false;
+        std::atomic<uint64_t> readAllocations = 0;
+        std::jthread writer([&] {
+            for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                (void) Config().Set("bench.hot.int", std::to_string(i % 1000));
+                (void) Config().Set("bench.hot.string", i % 2 ? "even" : "odd");
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned t = 0; t < readers; ++t) {
+                threads.emplace_back([&] {
+                    const uint64_t allocations = s_ThreadAllocations;
+                    for (uint64_t i = 0; i < s_OpsPerReader; ++i)
+                        Read();
+                    readAllocations.fetch_add(s_ThreadAllocations - allocations);
+                });
+            }
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        stop = true;
+
+        // latency of one read on one thread, threads beyond the core count wait for their turn
+        CBench::Report(name, s_OpsPerReader, elapsed * std::min(readers, std::max(1u, std::thread::hardware_concurrency())) / readers,
+                       readAllocations.load() / readers);
+    }
+}
+
+static void BenchReads(const CBench &Bench) {
+    const auto hotInt = Config().Register<int>(CConfigVariable<int>("bench.hot.int", 0, Validators::IntRanged(0, 100000)));
+    const auto hotString = Config().Register<std::string>(CConfigVariable<std::string>("bench.hot.string", "odd", Validators::StringNonEmpty()));
+
+    ContendedReads(Bench, "Get<int>/handle", [&] { DoNotOptimize(hotInt.Get()); });
+    ContendedReads(Bench, "Get<int>/cached", [&] { DoNotOptimize(hotInt.Cached()); });
+    ContendedReads(Bench, "Get<int>/registry", [] { DoNotOptimize(Config().Get<int>("bench.hot.int"_cfg)); });
+    ContendedReads(Bench, "Get<string>/handle", [&] { DoNotOptimize(hotString.Get()); });
+    ContendedReads(Bench, "Get<string>/shared", [&] { DoNotOptimize(hotString.Shared()); });
+}
+
+static void BenchValidators(const CBench &Bench) {
+    const CConfigGenerator generator;
+    const auto texts = generator.IntegerTexts(4096);
+    const auto intRanged = Validator<int>().Trim().NotEmpty().Integer().Range(0, 100000);
+    const ConfigValidator<int> validator = intRanged;
+
+    Bench.Run("Validator/IntRanged", 4'000'000, [&](uint64_t Ops) {
+        for (uint64_t i = 0; i < Ops; ++i)
+            DoNotOptimize(validator(texts[i % texts.size()]));
+    });
+
+    const std::vector<std::string_view> views(texts.begin(), texts.end());
+    std::vector<int> values(views.size());
+    ValidationErrors errors;
+    Bench.Run("Validator/IntRanged/batch", 4'000'000, [&](uint64_t Ops) {
+        for (uint64_t i = 0; i < Ops; i += views.size()) {
+            errors.clear();
+            DoNotOptimize(intRanged.ValidateBatch(views, values, errors));
+        }
+    });
+
+    // the comparison promised when parsing moved to std::from_chars, valid texts only since stoi throws
+    std::vector<std::string> valid;
+    for (const auto &text: texts) {
+        if (ValidatorStages::ParseInteger<int>(text).has_value())
+            valid.push_back(text);
+    }
+
+    Bench.Run("Parse/from_chars", 10'000'000, [&](uint64_t Ops) {
+        for (uint64_t i = 0; i < Ops; ++i)
+            DoNotOptimize(ValidatorStages::ParseInteger<int>(valid[i % valid.size()]));
+    });
+
+    Bench.Run("Parse/stoi", 10'000'000, [&](uint64_t Ops) {
+        for (uint64_t i = 0; i < Ops; ++i)
+            DoNotOptimize(std::stoi(valid[i % valid.size()]));
+    });
+
+    Config().Register<int>(CConfigVariable<int>("bench.set.int", 0, Validators::IntRanged(0, 100000)));
+    Bench.Run("Set<int>", 2'000'000, [&](uint64_t Ops) {
+        for (uint64_t i = 0; i < Ops; ++i)
+            DoNotOptimize(Config().Set("bench.set.int"_cfg, texts[i % texts.size()]));
+    });
+}
+
+static void BenchSerialization(const CBench &Bench) {
+    const CConfigGenerator generator;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "config-bench";
+    std::filesystem::create_directories(dir);
+    const std::string json = (dir / "config.json").string();
+    const std::string binary = (dir / "config.bin").string();
+    const std::string exported = (dir / "template.json").string();
+
+    size_t registered = 0;
+    for (const size_t keys: {1'000ul, 10'000ul, 100'000ul}) {
+        CConfigGenerator::Register(Config(), registered, keys);
+        registered = keys;
+
+        const std::string suffix = "/keys:" + std::to_string(keys);
+        const uint64_t rounds = std::max<uint64_t>(1, 200'000 / keys);
+        std::ofstream(json) << generator.Document(keys).dump();
+
+        Bench.Run("LoadFromFile" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().LoadFromFile(json));
+        });
+
+        Bench.Run("LoadFromFileStreaming" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().LoadFromFileStreaming(json));
+        });
+
+        Bench.Run("LoadFromFileLazy" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().LoadFromFileLazy(json));
+        });
+        (void) Config().ValidateAll();
+
+        Bench.Run("SaveToFile" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().SaveToFile(json));
+        });
+
+        Bench.Run("ExportTemplate" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().ExportTemplate(exported));
+        });
+
+        Bench.Run("SaveBinary" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().SaveBinary(binary));
+        });
+
+        Bench.Run("LoadBinary" + suffix, rounds, [&](uint64_t Ops) {
+            for (uint64_t i = 0; i < Ops; ++i)
+                DoNotOptimize(Config().LoadBinary(binary));
+        });
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+// usage: config-bench [filter], only benchmarks whose name contains filter run
+int main(int argc, char **argv) {
+    const CBench bench(argc > 1 ? argv[1] : "");
+
+    BenchReads(bench);
+    BenchValidators(bench);
+    BenchSerialization(bench);
+    return 0;
+}
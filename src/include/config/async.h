@@ -0,0 +1,75 @@
+#ifndef CONFIG_ASYNC_H
+#define CONFIG_ASYNC_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+class CConfigRegistry;
+
+// result of an asynchronous load, co_await it from a coroutine or block on Wait()
+// an awaiting coroutine is resumed on the thread that finished the load
+class CAsyncLoad {
+public:
+    using Result = std::expected<void, std::string>;
+
+private:
+    friend class CConfigRegistry;
+
+    struct SState {
+        std::mutex m_Mutex;
+        std::condition_variable m_Done;
+        std::optional<Result> m_Result;
+        std::coroutine_handle<> m_Waiter;
+    };
+
+    std::shared_ptr<SState> m_pState = std::make_shared<SState>();
+
+    // called once by whoever ran the load
+    void Complete(Result Value) const {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(m_pState->m_Mutex);
+            m_pState->m_Result = std::move(Value);
+            waiter = std::exchange(m_pState->m_Waiter, {});
+        }
+        m_pState->m_Done.notify_all();
+        if (waiter)
+            waiter.resume();
+    }
+
+public:
+    bool Ready() const {
+        std::lock_guard lock(m_pState->m_Mutex);
+        return m_pState->m_Result.has_value();
+    }
+
+    Result Wait() const {
+        std::unique_lock lock(m_pState->m_Mutex);
+        m_pState->m_Done.wait(lock, [this] { return m_pState->m_Result.has_value(); });
+        return *m_pState->m_Result;
+    }
+
+    bool await_ready() const { return Ready(); }
+
+    // false resumes right away, the load finished between await_ready and here
+    bool await_suspend(std::coroutine_handle<> Waiter) const {
+        std::lock_guard lock(m_pState->m_Mutex);
+        if (m_pState->m_Result.has_value())
+            return false;
+        m_pState->m_Waiter = Waiter;
+        return true;
+    }
+
+    Result await_resume() const {
+        std::lock_guard lock(m_pState->m_Mutex);
+        return *m_pState->m_Result;
+    }
+};
+
+#endif // CONFIG_ASYNC_H
@@ -0,0 +1,383 @@
+#ifndef CONFIG_BINARY_H
+#define CONFIG_BINARY_H
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+#include "table.h"
+#include "variable.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace nlohmann;
+
+// binary snapshot of a registry, meant as a startup cache next to the json file
+// layout, native endian, every section 8 byte aligned:
+//   SBinaryHeader
+//   SBinaryKey[m_Count], sorted by name hash
+//   data: names, string payloads and cbor for types without a native encoding
+enum class EBinaryType : uint8_t {
+    Integer = 1,
+    Float,
+    Boolean,
+    String,
+    Cbor,
+};
+
+struct SBinaryHeader {
+    char m_aMagic[4];
+    uint32_t m_Version;
+    uint64_t m_SchemaHash;
+    uint32_t m_Count;
+    uint32_t m_Reserved;
+    uint64_t m_DataSize;
+};
+
+struct SBinaryKey {
+    uint64_t m_Hash;
+    uint32_t m_NameOffset;
+    uint32_t m_NameSize;
+    uint32_t m_ValueSize;
+    EBinaryType m_Type;
+    uint8_t m_aPadding[3];
+    // integer, double or bool bits, or the data offset of String and Cbor payloads
+    uint64_t m_Value;
+};
+
+static_assert(sizeof(SBinaryHeader) == 32 && sizeof(SBinaryKey) == 32, "Binary layout changed");
+
+struct SBinaryValue {
+    std::string_view m_Name;
+    EBinaryType m_Type;
+    uint64_t m_Scalar;
+    std::string_view m_Bytes;
+};
+
+// calls Func with the concrete variable if its type has a native encoding, returns false otherwise
+template<typename V, typename F>
+bool VisitBinaryNative(V &Variable, F &&Func) {
+    auto visit = [&]<typename T>(std::type_identity<T>) {
+        if (Variable.Type() != typeid(T))
+            return false;
+        using Typed = std::conditional_t<std::is_const_v<V>, const CConfigVariable<T>, CConfigVariable<T> >;
+        Func(static_cast<Typed &>(Variable));
+        return true;
+    };
+    return visit(std::type_identity<bool>()) || visit(std::type_identity<int>()) ||
+           visit(std::type_identity<int64_t>()) || visit(std::type_identity<float>()) ||
+           visit(std::type_identity<double>()) || visit(std::type_identity<std::string>());
+}
+
+template<typename T>
+constexpr EBinaryType BinaryTypeOf() {
+    if constexpr (std::is_same_v<T, bool>)
+        return EBinaryType::Boolean;
+    else if constexpr (std::is_integral_v<T>)
+        return EBinaryType::Integer;
+    else if constexpr (std::is_floating_point_v<T>)
+        return EBinaryType::Float;
+    else if constexpr (std::is_same_v<T, std::string>)
+        return EBinaryType::String;
+    else
+        return EBinaryType::Cbor;
+}
+
+inline EBinaryType BinaryTypeOf(const IConfigVariableBase &Variable) {
+    EBinaryType type = EBinaryType::Cbor;
+    VisitBinaryNative(Variable, [&type]<typename T>(const CConfigVariable<T> &) { type = BinaryTypeOf<T>(); });
+    return type;
+}
+
+// order independent, so the registry can compute it from its unsorted table
+inline uint64_t BinarySchemaTerm(uint64_t NameHash, EBinaryType Type) {
+    return (NameHash ^ static_cast<uint64_t>(Type)) * 1099511628211ull;
+}
+
+// decodes one snapshot value into the variable, native values are handed to the validator as text like the
+// json loaders do, so a snapshot can't carry values a json file would be rejected for
+inline std::expected<void, std::string> ApplyBinaryValue(IConfigVariableBase &Variable, const SBinaryValue &Value) {
+    std::expected<void, std::string> result;
+    const bool native = VisitBinaryNative(Variable, [&]<typename T>(CConfigVariable<T> &typed) {
+        if (Value.m_Type != BinaryTypeOf<T>()) {
+            result = std::unexpected("Snapshot stores a different type");
+            return;
+        }
+
+        char aBuffer[32];
+        const auto format = [&aBuffer](auto Native) {
+            const auto [end, ec] = std::to_chars(aBuffer, aBuffer + sizeof(aBuffer), Native);
+            return std::string_view(aBuffer, ec == std::errc() ? end : aBuffer);
+        };
+
+        if constexpr (std::is_same_v<T, bool>) {
+            result = typed.TrySet(Value.m_Scalar != 0 ? "true" : "false", true);
+        } else if constexpr (std::is_integral_v<T>) {
+            const auto value = std::bit_cast<int64_t>(Value.m_Scalar);
+            if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max())
+                result = std::unexpected("Integer out of range");
+            else
+                result = typed.TrySet(format(static_cast<T>(value)), true);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            result = typed.TrySet(format(static_cast<T>(std::bit_cast<double>(Value.m_Scalar))), true);
+        } else {
+            result = typed.TrySet(Value.m_Bytes, true);
+        }
+    });
+    if (native)
+        return result;
+
+    if (Value.m_Type != EBinaryType::Cbor)
+        return std::unexpected("Snapshot stores a different type");
+    try {
+        return Variable.TrySetJson(json::from_cbor(Value.m_Bytes.begin(), Value.m_Bytes.end()), true);
+    } catch (const json::exception &e) {
+        return std::unexpected("CBOR parse error: " + std::string(e.what()));
+    }
+}
+
+class CBinaryBuilder {
+    std::vector<SBinaryKey> m_Keys;
+    std::string m_Data;
+    uint64_t m_SchemaHash = 0;
+
+    uint32_t AppendData(std::string_view Bytes) {
+        const auto offset = static_cast<uint32_t>(m_Data.size());
+        m_Data.append(Bytes);
+        return offset;
+    }
+
+    void Add(const CVariableTable::SEntry &Entry, EBinaryType Type, uint64_t Value, uint32_t Size = 0) {
+        SBinaryKey key{};
+        key.m_Hash = Entry.m_Hash;
+        key.m_NameOffset = AppendData(Entry.m_Name);
+        key.m_NameSize = static_cast<uint32_t>(Entry.m_Name.size());
+        key.m_ValueSize = Size;
+        key.m_Type = Type;
+        key.m_Value = Value;
+        m_Keys.push_back(key);
+        m_SchemaHash += BinarySchemaTerm(Entry.m_Hash, Type);
+    }
+
+    void AddBlob(const CVariableTable::SEntry &Entry, EBinaryType Type, std::string_view Bytes) {
+        const uint32_t offset = AppendData(Bytes);
+        Add(Entry, Type, offset, static_cast<uint32_t>(Bytes.size()));
+    }
+
+public:
+    void Reserve(size_t Count) { m_Keys.reserve(Count); }
+
+    void Add(const CVariableTable::SEntry &Entry) {
+        const bool native = VisitBinaryNative(*Entry.m_Variable, [&]<typename T>(const CConfigVariable<T> &typed) {
+            const T value = typed.Value();
+            if constexpr (std::is_same_v<T, bool>)
+                Add(Entry, EBinaryType::Boolean, value ? 1 : 0);
+            else if constexpr (std::is_integral_v<T>)
+                Add(Entry, EBinaryType::Integer, std::bit_cast<uint64_t>(static_cast<int64_t>(value)));
+            else if constexpr (std::is_floating_point_v<T>)
+                Add(Entry, EBinaryType::Float, std::bit_cast<uint64_t>(static_cast<double>(value)));
+            else
+                AddBlob(Entry, EBinaryType::String, value);
+        });
+        if (native)
+            return;
+
+        const std::vector<uint8_t> cbor = json::to_cbor(Entry.m_Variable->ValueAsJson());
+        AddBlob(Entry, EBinaryType::Cbor, std::string_view(reinterpret_cast<const char *>(cbor.data()), cbor.size()));
+    }
+
+    std::string Finish() {
+        std::ranges::sort(m_Keys, {}, &SBinaryKey::m_Hash);
+
+        SBinaryHeader header{};
+        std::memcpy(header.m_aMagic, "CFGB", 4);
+        header.m_Version = 1;
+        header.m_SchemaHash = m_SchemaHash;
+        header.m_Count = static_cast<uint32_t>(m_Keys.size());
+        header.m_DataSize = m_Data.size();
+
+        std::string out;
+        out.reserve(sizeof(header) + m_Keys.size() * sizeof(SBinaryKey) + m_Data.size());
+        out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.append(reinterpret_cast<const char *>(m_Keys.data()), m_Keys.size() * sizeof(SBinaryKey));
+        out.append(m_Data);
+        return out;
+    }
+};
+
+// read-only view over a snapshot, Open only checks the header and the size of the key table
+// each key is bounds checked when it is read, the bytes are never copied
+class CBinarySnapshot {
+    SBinaryHeader m_Header{};
+    const char *m_pKeys = nullptr;
+    std::string_view m_Data;
+
+    SBinaryKey Key(size_t Index) const {
+        SBinaryKey key;
+        std::memcpy(&key, m_pKeys + Index * sizeof(SBinaryKey), sizeof(key));
+        return key;
+    }
+
+    std::optional<std::string_view> Slice(uint64_t Offset, uint64_t Size) const {
+        if (Offset > m_Data.size() || Size > m_Data.size() - Offset)
+            return std::nullopt;
+        return m_Data.substr(Offset, Size);
+    }
+
+public:
+    static std::expected<CBinarySnapshot, std::string> Open(std::span<const char> Bytes) {
+        CBinarySnapshot snapshot;
+        if (Bytes.size() < sizeof(SBinaryHeader))
+            return std::unexpected("Binary snapshot is truncated");
+        std::memcpy(&snapshot.m_Header, Bytes.data(), sizeof(SBinaryHeader));
+        if (std::memcmp(snapshot.m_Header.m_aMagic, "CFGB", 4) != 0)
+            return std::unexpected("Not a binary config snapshot");
+        if (snapshot.m_Header.m_Version != 1)
+            return std::unexpected("Unsupported binary snapshot version " + std::to_string(snapshot.m_Header.m_Version));
+
+        const uint64_t keysSize = uint64_t(snapshot.m_Header.m_Count) * sizeof(SBinaryKey);
+        if (Bytes.size() - sizeof(SBinaryHeader) < keysSize ||
+            Bytes.size() - sizeof(SBinaryHeader) - keysSize != snapshot.m_Header.m_DataSize)
+            return std::unexpected("Binary snapshot is truncated");
+
+        snapshot.m_pKeys = Bytes.data() + sizeof(SBinaryHeader);
+        snapshot.m_Data = std::string_view(snapshot.m_pKeys + keysSize, snapshot.m_Header.m_DataSize);
+        return snapshot;
+    }
+
+    uint64_t SchemaHash() const { return m_Header.m_SchemaHash; }
+    size_t Size() const { return m_Header.m_Count; }
+
+    std::expected<SBinaryValue, std::string> Value(size_t Index) const {
+        const SBinaryKey key = Key(Index);
+        const auto name = Slice(key.m_NameOffset, key.m_NameSize);
+        if (!name.has_value())
+            return std::unexpected("Binary snapshot key " + std::to_string(Index) + " is out of bounds");
+
+        SBinaryValue value{*name, key.m_Type, key.m_Value, {}};
+        switch (key.m_Type) {
+            case EBinaryType::Integer:
+            case EBinaryType::Float:
+            case EBinaryType::Boolean:
+                return value;
+            case EBinaryType::String:
+            case EBinaryType::Cbor:
+                if (const auto bytes = Slice(key.m_Value, key.m_ValueSize)) {
+                    value.m_Bytes = *bytes;
+                    return value;
+                }
+                return std::unexpected(std::string(*name) + ": value is out of bounds");
+        }
+        return std::unexpected(std::string(*name) + ": unknown value type");
+    }
+
+    // binary search on the name hash, nothing is decoded besides the matching key
+    std::optional<SBinaryValue> Find(const CConfigKey &Key) const {
+        size_t first = 0, count = Size();
+        while (count > 0) {
+            const size_t step = count / 2;
+            if (this->Key(first + step).m_Hash < Key.Hash()) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+
+        for (; first < Size() && this->Key(first).m_Hash == Key.Hash(); ++first) {
+            auto value = Value(first);
+            if (value.has_value() && value->m_Name == Key.Name())
+                return *value;
+        }
+        return std::nullopt;
+    }
+};
+
+// read-only mapping of a whole file, falls back to reading it into memory where mmap is unavailable
+// an empty file maps to an empty span
+class CMappedFile {
+#if defined(_WIN32)
+    std::string m_Contents;
+#else
+    const char *m_pData = nullptr;
+    size_t m_Size = 0;
+#endif
+
+public:
+    CMappedFile() = default;
+
+    CMappedFile(const CMappedFile &) = delete;
+    CMappedFile &operator=(const CMappedFile &) = delete;
+
+    ~CMappedFile() {
+#if !defined(_WIN32)
+        if (m_pData)
+            munmap(const_cast<char *>(m_pData), m_Size);
+#endif
+    }
+
+    std::expected<void, std::string> Open(const std::string &filepath) {
+#if defined(_WIN32)
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open())
+            return std::unexpected("Failed to open file for reading: " + filepath);
+        m_Contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+#else
+        const int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT)
+                return std::unexpected("File doesn't exist");
+            return std::unexpected("Failed to open file for reading: " + filepath);
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return std::unexpected("Failed to stat " + filepath);
+        }
+        if (st.st_size == 0) {
+            close(fd);
+            return {};
+        }
+
+        void *pData = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (pData == MAP_FAILED)
+            return std::unexpected("Failed to map " + filepath);
+
+        m_pData = static_cast<const char *>(pData);
+        m_Size = static_cast<size_t>(st.st_size);
+#endif
+        return {};
+    }
+
+    std::span<const char> Data() const {
+#if defined(_WIN32)
+        return m_Contents;
+#else
+        return {m_pData, m_Size};
+#endif
+    }
+};
+
+#endif // CONFIG_BINARY_H
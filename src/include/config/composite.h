@@ -0,0 +1,131 @@
+#ifndef CONFIG_COMPOSITE_H
+#define CONFIG_COMPOSITE_H
+
+#include <charconv>
+#include <expected>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+using namespace nlohmann;
+
+// list, map and struct values are converted from json once when they are set and stored natively
+// structs take part by providing nlohmann to_json and from_json, e.g. NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE
+template<typename T>
+constexpr bool IsCompositeValue() {
+    return !std::is_arithmetic_v<T> && !std::is_enum_v<T> && !std::is_same_v<T, std::string>;
+}
+
+namespace ConfigComposite {
+// "/hosts/2/port" -> {"hosts", "/2/port"}, segments are escaped like json pointers
+inline std::expected<std::pair<std::string, std::string_view>, std::string> Split(std::string_view Path) {
+    if (!Path.starts_with('/'))
+        return std::unexpected("Nested path '" + std::string(Path) + "' has to start with '/'");
+
+    Path.remove_prefix(1);
+    const size_t slash = Path.find('/');
+    const std::string_view raw = Path.substr(0, slash);
+    std::string segment;
+    segment.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == '~' && i + 1 < raw.size())
+            segment += raw[++i] == '1' ? '/' : '~';
+        else
+            segment += raw[i];
+    }
+    return std::pair(std::move(segment), slash == std::string_view::npos ? std::string_view() : Path.substr(slash));
+}
+} // namespace ConfigComposite
+
+// writes Element at Path inside Value, an empty path replaces Value itself
+// json conversion errors are thrown as json::exception like get<T>() does
+template<typename T>
+struct SNestedAccess {
+    // types without element access of their own, structs mostly, are patched through their json form
+    static std::expected<void, std::string> Assign(T &Value, std::string_view Path, const json &Element) {
+        if (Path.empty()) {
+            Value = Element.get<T>();
+            return {};
+        }
+        if constexpr (!IsCompositeValue<T>()) {
+            return std::unexpected("Nested path '" + std::string(Path) + "' leads into a scalar value");
+        } else {
+            json tree = Value;
+            tree[json::json_pointer(std::string(Path))] = Element;
+            Value = tree.get<T>();
+            return {};
+        }
+    }
+};
+
+template<typename U, typename A>
+struct SNestedAccess<std::vector<U, A> > {
+    // "/2" replaces the third element, "/-" appends one
+    static std::expected<void, std::string> Assign(std::vector<U, A> &Value, std::string_view Path, const json &Element) {
+        if (Path.empty()) {
+            Value = Element.get<std::vector<U, A> >();
+            return {};
+        }
+
+        const auto split = ConfigComposite::Split(Path);
+        if (!split.has_value())
+            return std::unexpected(split.error());
+        const auto &[segment, rest] = *split;
+
+        if (segment == "-") {
+            if (!rest.empty())
+                return std::unexpected("Nested path '" + std::string(Path) + "' continues past an appended element");
+            Value.push_back(Element.get<U>());
+            return {};
+        }
+
+        size_t index = 0;
+        const auto [end, ec] = std::from_chars(segment.data(), segment.data() + segment.size(), index);
+        if (segment.empty() || ec != std::errc() || end != segment.data() + segment.size())
+            return std::unexpected("'" + segment + "' is not a list index");
+        if (index >= Value.size())
+            return std::unexpected("List index " + segment + " is out of range");
+
+        if (rest.empty()) {
+            Value[index] = Element.get<U>();
+            return {};
+        }
+        if constexpr (std::is_same_v<U, bool>)
+            return std::unexpected("Nested path '" + std::string(Path) + "' leads into a scalar value");
+        else
+            return SNestedAccess<U>::Assign(Value[index], rest, Element);
+    }
+};
+
+template<typename U, typename C, typename A>
+struct SNestedAccess<std::map<std::string, U, C, A> > {
+    // "/key" sets or adds one entry
+    static std::expected<void, std::string> Assign(std::map<std::string, U, C, A> &Value, std::string_view Path, const json &Element) {
+        if (Path.empty()) {
+            Value = Element.get<std::map<std::string, U, C, A> >();
+            return {};
+        }
+
+        const auto split = ConfigComposite::Split(Path);
+        if (!split.has_value())
+            return std::unexpected(split.error());
+        const auto &[segment, rest] = *split;
+
+        if (rest.empty()) {
+            Value.insert_or_assign(segment, Element.get<U>());
+            return {};
+        }
+
+        const auto it = Value.find(segment);
+        if (it == Value.end())
+            return std::unexpected("Map key '" + segment + "' not found");
+        return SNestedAccess<U>::Assign(it->second, rest, Element);
+    }
+};
+
+#endif // CONFIG_COMPOSITE_H
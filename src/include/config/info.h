@@ -0,0 +1,100 @@
+#ifndef CONFIG_INFO_H
+#define CONFIG_INFO_H
+
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "binary.h"
+#include "variable.h"
+
+// typed value of a variable, text is only produced when Text() is asked for it
+// strings are held by the shared copy the variable published, nothing is copied or formatted up front
+class CValueView {
+public:
+    using Value = std::variant<bool, int, int64_t, float, double, std::string_view>;
+
+private:
+    Value m_Value;
+    // keeps m_Value's string_view alive for values stored out of line
+    std::shared_ptr<const std::string> m_pOwner;
+
+public:
+    CValueView() = default;
+
+    template<typename T>
+    requires std::is_arithmetic_v<T>
+    explicit CValueView(T Native) : m_Value(Native) {
+    }
+
+    explicit CValueView(std::shared_ptr<const std::string> pString) : m_Value(std::string_view(*pString)), m_pOwner(std::move(pString)) {
+    }
+
+    // current value of Variable, types without a native representation fall back to ValueAsString()
+    static CValueView Current(const IConfigVariableBase &Variable) {
+        CValueView view;
+        const bool native = VisitBinaryNative(Variable, [&view]<typename T>(const CConfigVariable<T> &typed) {
+            if constexpr (std::is_same_v<T, std::string>)
+                view = CValueView(typed.SharedValue());
+            else
+                view = CValueView(typed.Value());
+        });
+        if (!native)
+            view = CValueView(std::make_shared<const std::string>(Variable.ValueAsString()));
+        return view;
+    }
+
+    // defaults never change, strings point into the variable
+    static CValueView Default(const IConfigVariableBase &Variable) {
+        CValueView view;
+        const bool native = VisitBinaryNative(Variable, [&view]<typename T>(const CConfigVariable<T> &typed) {
+            if constexpr (std::is_same_v<T, std::string>)
+                view.m_Value = std::string_view(typed.DefaultValue());
+            else
+                view = CValueView(typed.DefaultValue());
+        });
+        if (!native)
+            view = CValueView(std::make_shared<const std::string>(Variable.DefaultValueAsString()));
+        return view;
+    }
+
+    const Value &Get() const { return m_Value; }
+
+    // nullptr unless the value is a T, strings come out as std::string_view
+    template<typename T>
+    const T *As() const { return std::get_if<T>(&m_Value); }
+
+    // strings are returned as they are, everything else is formatted into Buffer with std::to_chars
+    // Buffer is only reused, keeping it across calls avoids allocating for every value
+    std::string_view Text(std::string &Buffer) const {
+        return std::visit([&Buffer]<typename T>(const T &value) -> std::string_view {
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return value;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return value ? "true" : "false";
+            } else {
+                Buffer.resize(32);
+                const auto [end, ec] = std::to_chars(Buffer.data(), Buffer.data() + Buffer.size(), value);
+                Buffer.resize(ec == std::errc() ? end - Buffer.data() : 0);
+                return Buffer;
+            }
+        }, m_Value);
+    }
+};
+
+// one variable as ForEachInfo hands it out, the views stay valid as long as the registry does
+struct SVariableInfoView {
+    std::string_view m_Name;
+    std::string_view m_Type;
+    std::optional<std::string_view> m_Description;
+    bool m_ReadOnly = false;
+    CValueView m_Value;
+    CValueView m_Default;
+};
+
+#endif // CONFIG_INFO_H
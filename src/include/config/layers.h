@@ -0,0 +1,166 @@
+#ifndef CONFIG_LAYERS_H
+#define CONFIG_LAYERS_H
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// named value sources stacked by priority, the highest priority layer holding a name decides its value
+// values are text and go through the variable's validator like Set(), the registry stores the winner
+// so reads never look at the layers
+class CConfigLayers {
+public:
+    using Values = std::map<std::string, std::string, std::less<> >;
+
+private:
+    struct SLayer {
+        std::string m_Name;
+        int m_Priority;
+        Values m_Values;
+        // set by the first change that went through, see MarkFilled
+        bool m_Filled = false;
+    };
+
+    // highest priority first, priorities are unique
+    std::vector<SLayer> m_Layers;
+
+    SLayer *Layer(std::string_view Name) {
+        const auto it = std::ranges::find(m_Layers, Name, &SLayer::m_Name);
+        return it == m_Layers.end() ? nullptr : &*it;
+    }
+
+public:
+    // fails if the name or the priority is already taken
+    bool Add(std::string Name, int Priority) {
+        if (Contains(Name) || std::ranges::find(m_Layers, Priority, &SLayer::m_Priority) != m_Layers.end())
+            return false;
+
+        const auto it = std::ranges::find_if(m_Layers, [Priority](const SLayer &layer) { return layer.m_Priority < Priority; });
+        m_Layers.insert(it, SLayer{std::move(Name), Priority, {}, false});
+        return true;
+    }
+
+    bool Contains(std::string_view Name) const { return std::ranges::find(m_Layers, Name, &SLayer::m_Name) != m_Layers.end(); }
+
+    // values of a layer, nullptr if there is no such layer
+    const Values *Find(std::string_view Name) const {
+        const auto it = std::ranges::find(m_Layers, Name, &SLayer::m_Name);
+        return it == m_Layers.end() ? nullptr : &it->m_Values;
+    }
+
+    // false until the layer's first fill went through, that fill may set read-only variables like a load does
+    bool Filled(std::string_view Name) const {
+        const auto it = std::ranges::find(m_Layers, Name, &SLayer::m_Name);
+        return it != m_Layers.end() && it->m_Filled;
+    }
+
+    void MarkFilled(std::string_view Name) {
+        if (SLayer *pLayer = Layer(Name))
+            pLayer->m_Filled = true;
+    }
+
+    std::optional<int> Priority(std::string_view Name) const {
+        const auto it = std::ranges::find(m_Layers, Name, &SLayer::m_Name);
+        return it == m_Layers.end() ? std::nullopt : std::optional(it->m_Priority);
+    }
+
+    // swaps in new values for a layer and returns the old ones, nullopt if there is no such layer
+    std::optional<Values> Replace(std::string_view Name, Values NewValues) {
+        SLayer *pLayer = Layer(Name);
+        if (!pLayer)
+            return std::nullopt;
+        std::swap(pLayer->m_Values, NewValues);
+        return NewValues;
+    }
+
+    // sets or, with nullopt, erases one value of an existing layer and returns what it held before
+    std::optional<std::string> Assign(std::string_view Name, std::string_view Key, std::optional<std::string> Value) {
+        SLayer *pLayer = Layer(Name);
+        std::optional<std::string> previous;
+        const auto it = pLayer->m_Values.find(Key);
+        if (it != pLayer->m_Values.end()) {
+            previous = std::move(it->second);
+            pLayer->m_Values.erase(it);
+        }
+        if (Value)
+            pLayer->m_Values.emplace(std::string(Key), std::move(*Value));
+        return previous;
+    }
+
+    // takes the layer out and returns its values, nullopt if there is no such layer
+    std::optional<Values> Remove(std::string_view Name) {
+        const auto it = std::ranges::find(m_Layers, Name, &SLayer::m_Name);
+        if (it == m_Layers.end())
+            return std::nullopt;
+        Values values = std::move(it->m_Values);
+        m_Layers.erase(it);
+        return values;
+    }
+
+    // value the highest priority layer holds for Key, nullptr if none of them does
+    const std::string *Effective(std::string_view Key) const {
+        for (const auto &layer: m_Layers) {
+            if (const auto it = layer.m_Values.find(Key); it != layer.m_Values.end())
+                return &it->second;
+        }
+        return nullptr;
+    }
+
+    // keys whose value differs between two versions of a layer, in one merge pass over both
+    static std::vector<std::string> Diff(const Values &Before, const Values &After) {
+        std::vector<std::string> keys;
+        auto before = Before.begin();
+        auto after = After.begin();
+        while (before != Before.end() || after != After.end()) {
+            if (after == After.end() || (before != Before.end() && before->first < after->first)) {
+                keys.push_back((before++)->first);
+            } else if (before == Before.end() || after->first < before->first) {
+                keys.push_back((after++)->first);
+            } else {
+                if (before->second != after->second)
+                    keys.push_back(before->first);
+                ++before;
+                ++after;
+            }
+        }
+        return keys;
+    }
+
+    static std::vector<std::string> Keys(const Values &Layer) {
+        std::vector<std::string> keys;
+        keys.reserve(Layer.size());
+        for (const auto &key: Layer | std::views::keys)
+            keys.push_back(key);
+        return keys;
+    }
+
+    // "net.http.port" with prefix "APP_" -> "APP_NET_HTTP_PORT"
+    static std::string EnvironmentName(std::string_view Prefix, std::string_view Name) {
+        std::string env(Prefix);
+        env.reserve(Prefix.size() + Name.size());
+        for (const char c: Name)
+            env += c == '.' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return env;
+    }
+
+    // "--net.http.port=8080" -> {"net.http.port", "8080"}, every other argument is skipped
+    static Values FromArguments(int argc, const char *const *argv) {
+        Values values;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const size_t equals = arg.find('=');
+            if (!arg.starts_with("--") || equals == std::string_view::npos || equals == 2)
+                continue;
+            values.insert_or_assign(std::string(arg.substr(2, equals - 2)), std::string(arg.substr(equals + 1)));
+        }
+        return values;
+    }
+};
+
+#endif // CONFIG_LAYERS_H
@@ -0,0 +1,288 @@
+#ifndef CONFIG_METRICS_H
+#define CONFIG_METRICS_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// registry instrumentation, built with CONFIG_ENABLE_METRICS
+// without it CConfigMetrics is an empty type whose calls compile to nothing
+#if defined(CONFIG_ENABLE_METRICS) && CONFIG_ENABLE_METRICS
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <map>
+
+// counters are spread over cache line sized shards, every thread sticks to one of them
+// writers never share a line with another shard, reads sum all of them
+namespace MetricsDetail {
+    inline constexpr size_t s_Shards = 16;
+
+    inline size_t ShardIndex() {
+        static std::atomic<size_t> s_Next = 0;
+        thread_local const size_t s_Index = s_Next.fetch_add(1, std::memory_order_relaxed) % s_Shards;
+        return s_Index;
+    }
+
+    inline uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+class CShardedCounter {
+    struct alignas(64) SShard {
+        std::atomic<uint64_t> m_Value = 0;
+    };
+
+    std::array<SShard, MetricsDetail::s_Shards> m_aShards;
+
+public:
+    void Add(uint64_t Value) { m_aShards[MetricsDetail::ShardIndex()].m_Value.fetch_add(Value, std::memory_order_relaxed); }
+
+    uint64_t Value() const {
+        uint64_t value = 0;
+        for (const auto &shard: m_aShards)
+            value += shard.m_Value.load(std::memory_order_relaxed);
+        return value;
+    }
+};
+
+// durations in power of two nanosecond buckets, bucket i counts durations below 2^i ns
+class CLatencyHistogram {
+public:
+    static constexpr size_t s_Buckets = 40;
+
+    struct SSnapshot {
+        std::array<uint64_t, s_Buckets> m_aBuckets{};
+        uint64_t m_Count = 0;
+        uint64_t m_SumNs = 0;
+    };
+
+private:
+    struct alignas(64) SShard {
+        std::array<std::atomic<uint64_t>, s_Buckets> m_aBuckets{};
+        std::atomic<uint64_t> m_Count = 0;
+        std::atomic<uint64_t> m_SumNs = 0;
+    };
+
+    std::array<SShard, MetricsDetail::s_Shards> m_aShards;
+
+public:
+    void Record(uint64_t Ns) {
+        SShard &shard = m_aShards[MetricsDetail::ShardIndex()];
+        const size_t bucket = std::min<size_t>(std::bit_width(Ns), s_Buckets - 1);
+        shard.m_aBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        shard.m_Count.fetch_add(1, std::memory_order_relaxed);
+        shard.m_SumNs.fetch_add(Ns, std::memory_order_relaxed);
+    }
+
+    SSnapshot Snapshot() const {
+        SSnapshot snapshot;
+        for (const auto &shard: m_aShards) {
+            for (size_t i = 0; i < s_Buckets; ++i)
+                snapshot.m_aBuckets[i] += shard.m_aBuckets[i].load(std::memory_order_relaxed);
+            snapshot.m_Count += shard.m_Count.load(std::memory_order_relaxed);
+            snapshot.m_SumNs += shard.m_SumNs.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+};
+
+class CConfigMetrics {
+public:
+    enum EOperation {
+        OP_GET,
+        OP_SET,
+        OP_LOAD,
+        OP_PARSE,
+        OP_APPLY,
+        OP_SAVE,
+        OP_EXPORT,
+        NUM_OPS,
+    };
+
+    static constexpr std::array<std::string_view, NUM_OPS> s_aOperationNames = {
+        "get", "set", "load", "parse", "apply", "save", "export",
+    };
+
+    class CTimer {
+        CLatencyHistogram *m_pHistogram;
+        uint64_t m_Start;
+
+    public:
+        explicit CTimer(CLatencyHistogram &Histogram) : m_pHistogram(&Histogram), m_Start(MetricsDetail::Now()) {
+        }
+
+        CTimer(const CTimer &) = delete;
+        CTimer &operator=(const CTimer &) = delete;
+
+        ~CTimer() { m_pHistogram->Record(MetricsDetail::Now() - m_Start); }
+    };
+
+private:
+    std::array<CLatencyHistogram, NUM_OPS> m_aOperations;
+    CLatencyHistogram m_LockWait;
+    CLatencyHistogram m_LockHold;
+    CShardedCounter m_BytesRead;
+    CShardedCounter m_BytesWritten;
+    // failures only happen on the slow path, a plain map is enough
+    mutable std::mutex m_FailureMutex;
+    std::map<std::string, uint64_t, std::less<> > m_ValidationFailures;
+
+    static std::string Seconds(double Ns) {
+        char buffer[32];
+        const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), Ns / 1e9);
+        return std::string(buffer, ec == std::errc() ? end : buffer);
+    }
+
+    static void AppendHistogram(std::string &Out, std::string_view Name, std::string_view Labels,
+                                const CLatencyHistogram::SSnapshot &Snapshot) {
+        const std::string separator = Labels.empty() ? "" : ",";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < CLatencyHistogram::s_Buckets - 1; ++i) {
+            cumulative += Snapshot.m_aBuckets[i];
+            Out += std::string(Name) + "_bucket{" + std::string(Labels) + separator + "le=\"" +
+                   Seconds(static_cast<double>(uint64_t(1) << i)) + "\"} " + std::to_string(cumulative) + "\n";
+        }
+        Out += std::string(Name) + "_bucket{" + std::string(Labels) + separator + "le=\"+Inf\"} " + std::to_string(Snapshot.m_Count) + "\n";
+        const std::string labels = Labels.empty() ? "" : "{" + std::string(Labels) + "}";
+        Out += std::string(Name) + "_sum" + labels + " " + Seconds(static_cast<double>(Snapshot.m_SumNs)) + "\n";
+        Out += std::string(Name) + "_count" + labels + " " + std::to_string(Snapshot.m_Count) + "\n";
+    }
+
+    static std::string EscapeLabel(std::string_view Value) {
+        std::string escaped;
+        for (const char c: Value) {
+            if (c == '\\' || c == '"')
+                escaped += '\\';
+            if (c == '\n') {
+                escaped += "\\n";
+                continue;
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+public:
+    static constexpr bool s_Enabled = true;
+
+    CTimer Time(EOperation Op) { return CTimer(m_aOperations[Op]); }
+
+    void LockAcquired(uint64_t WaitNs) { m_LockWait.Record(WaitNs); }
+    void LockReleased(uint64_t HoldNs) { m_LockHold.Record(HoldNs); }
+
+    void BytesRead(uint64_t Bytes) { m_BytesRead.Add(Bytes); }
+    void BytesWritten(uint64_t Bytes) { m_BytesWritten.Add(Bytes); }
+
+    void ValidationFailed(std::string_view Name) {
+        std::lock_guard lock(m_FailureMutex);
+        auto it = m_ValidationFailures.find(Name);
+        if (it == m_ValidationFailures.end())
+            it = m_ValidationFailures.emplace(std::string(Name), 0).first;
+        ++it->second;
+    }
+
+    CLatencyHistogram::SSnapshot Operation(EOperation Op) const { return m_aOperations[Op].Snapshot(); }
+    CLatencyHistogram::SSnapshot LockWait() const { return m_LockWait.Snapshot(); }
+    CLatencyHistogram::SSnapshot LockHold() const { return m_LockHold.Snapshot(); }
+    uint64_t BytesRead() const { return m_BytesRead.Value(); }
+    uint64_t BytesWritten() const { return m_BytesWritten.Value(); }
+
+    std::map<std::string, uint64_t, std::less<> > ValidationFailures() const {
+        std::lock_guard lock(m_FailureMutex);
+        return m_ValidationFailures;
+    }
+
+    // Prometheus text exposition format
+    std::string Prometheus() const {
+        std::string out;
+        out += "# TYPE config_operation_seconds histogram\n";
+        for (size_t op = 0; op < NUM_OPS; ++op)
+            AppendHistogram(out, "config_operation_seconds", "op=\"" + std::string(s_aOperationNames[op]) + "\"",
+                            m_aOperations[op].Snapshot());
+
+        out += "# TYPE config_lock_wait_seconds histogram\n";
+        AppendHistogram(out, "config_lock_wait_seconds", "", m_LockWait.Snapshot());
+        out += "# TYPE config_lock_hold_seconds histogram\n";
+        AppendHistogram(out, "config_lock_hold_seconds", "", m_LockHold.Snapshot());
+
+        out += "# TYPE config_read_bytes_total counter\n";
+        out += "config_read_bytes_total " + std::to_string(BytesRead()) + "\n";
+        out += "# TYPE config_written_bytes_total counter\n";
+        out += "config_written_bytes_total " + std::to_string(BytesWritten()) + "\n";
+
+        out += "# TYPE config_validation_failures_total counter\n";
+        for (const auto &[name, count]: ValidationFailures())
+            out += "config_validation_failures_total{variable=\"" + EscapeLabel(name) + "\"} " + std::to_string(count) + "\n";
+        return out;
+    }
+};
+
+// lock_guard that records how long the lock took to get and how long it was held
+template<typename M>
+class CMeasuredLock {
+    M &m_Mutex;
+    CConfigMetrics &m_Metrics;
+    uint64_t m_Acquired;
+
+public:
+    CMeasuredLock(M &Mutex, CConfigMetrics &Metrics) : m_Mutex(Mutex), m_Metrics(Metrics) {
+        const uint64_t start = MetricsDetail::Now();
+        m_Mutex.lock();
+        m_Acquired = MetricsDetail::Now();
+        m_Metrics.LockAcquired(m_Acquired - start);
+    }
+
+    CMeasuredLock(const CMeasuredLock &) = delete;
+    CMeasuredLock &operator=(const CMeasuredLock &) = delete;
+
+    ~CMeasuredLock() {
+        m_Mutex.unlock();
+        m_Metrics.LockReleased(MetricsDetail::Now() - m_Acquired);
+    }
+};
+
+#else
+
+class CConfigMetrics {
+public:
+    enum EOperation {
+        OP_GET,
+        OP_SET,
+        OP_LOAD,
+        OP_PARSE,
+        OP_APPLY,
+        OP_SAVE,
+        OP_EXPORT,
+        NUM_OPS,
+    };
+
+    struct STimer {
+    };
+
+    static constexpr bool s_Enabled = false;
+
+    STimer Time(EOperation) { return {}; }
+    void BytesRead(uint64_t) {}
+    void BytesWritten(uint64_t) {}
+    void ValidationFailed(std::string_view) {}
+    std::string Prometheus() const { return {}; }
+};
+
+template<typename M>
+class CMeasuredLock {
+    std::lock_guard<M> m_Lock;
+
+public:
+    CMeasuredLock(M &Mutex, CConfigMetrics &) : m_Lock(Mutex) {
+    }
+};
+
+#endif
+
+#endif // CONFIG_METRICS_H
@@ -0,0 +1,150 @@
+#ifndef CONFIG_OVERLAY_H
+#define CONFIG_OVERLAY_H
+
+#include <atomic>
+#include <expected>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+#include "registry.h"
+
+using namespace nlohmann;
+
+// per tenant view of a base registry that only stores the variables it overrides
+// everything else is read straight from the base, so memory grows with the overrides and not with the base
+// overrides are validated like the base variable and keep its read-only flag, the base has to outlive the overlay
+class CConfigOverlay {
+    using Overrides = std::map<std::string, std::shared_ptr<IConfigVariableBase>, std::less<> >;
+
+    const CConfigRegistry &m_Base;
+    // copied on adding or dropping an override, values of existing overrides are stored in place
+    std::atomic<std::shared_ptr<const Overrides> > m_pOverrides = std::make_shared<const Overrides>();
+    // serializes writers, readers only load m_pOverrides
+    std::mutex m_Mutex;
+
+    // the override of key or the base variable, the caller's snapshot of the overrides keeps it alive
+    const IConfigVariableBase *Find(CConfigKey key, const Overrides &overrides) const {
+        if (const auto it = overrides.find(key.Name()); it != overrides.end())
+            return it->second.get();
+        const auto *entry = m_Base.m_Variables.Find(key);
+        return entry ? entry->m_Variable.get() : nullptr;
+    }
+
+    // called with m_Mutex held, the override of key, created from the base variable on first use
+    template<typename F>
+    std::expected<void, std::string> Write(CConfigKey key, F &&write) {
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        if (const auto it = overrides->find(key.Name()); it != overrides->end())
+            return write(*it->second);
+
+        const auto *entry = m_Base.m_Variables.Find(key);
+        if (!entry)
+            return std::unexpected("Variable '" + std::string(key.Name()) + "' not found");
+
+        std::shared_ptr<IConfigVariableBase> variable = entry->m_Variable->Clone();
+        if (auto result = write(*variable); !result.has_value())
+            return result;
+
+        auto copy = std::make_shared<Overrides>(*overrides);
+        copy->emplace(entry->m_Name, std::move(variable));
+        m_pOverrides.store(std::move(copy), std::memory_order_release);
+        return {};
+    }
+
+public:
+    explicit CConfigOverlay(const CConfigRegistry &base) : m_Base(base) {
+    }
+
+    CConfigOverlay(const CConfigOverlay &) = delete;
+    CConfigOverlay &operator=(const CConfigOverlay &) = delete;
+
+    const CConfigRegistry &Base() const { return m_Base; }
+
+    template<typename T>
+    std::optional<T> Get(CConfigKey key) const {
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        auto *wrapper = dynamic_cast<const CConfigVariable<T> *>(Find(key, *overrides));
+        if (!wrapper)
+            return std::nullopt;
+
+        return wrapper->Value();
+    }
+
+    // like CConfigRegistry::GetShared, the value stays valid while the pointer is held
+    template<typename T>
+    std::shared_ptr<const T> GetShared(CConfigKey key) const requires (!IsInlineValue<T>()) {
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        auto *wrapper = dynamic_cast<const CConfigVariable<T> *>(Find(key, *overrides));
+        if (!wrapper)
+            return nullptr;
+
+        return wrapper->SharedValue();
+    }
+
+    std::optional<std::string> GetAsString(CConfigKey key) const {
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        const auto *variable = Find(key, *overrides);
+        if (!variable)
+            return std::nullopt;
+        return variable->ValueAsString();
+    }
+
+    bool Overridden(CConfigKey key) const { return m_pOverrides.load(std::memory_order_acquire)->contains(key.Name()); }
+
+    size_t Size() const { return m_pOverrides.load(std::memory_order_acquire)->size(); }
+
+    // names of the overridden variables, sorted
+    std::vector<std::string> List() const {
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        std::vector<std::string> names;
+        names.reserve(overrides->size());
+        for (const auto &name: *overrides | std::views::keys)
+            names.push_back(name);
+        return names;
+    }
+
+    // overrides a base variable, nothing is stored if the value is invalid
+    std::expected<void, std::string> Set(CConfigKey key, std::string_view value) {
+        std::lock_guard lock(m_Mutex);
+        return Write(key, [value](IConfigVariableBase &variable) { return variable.TrySet(value); });
+    }
+
+    std::expected<void, std::string> SetJson(CConfigKey key, const json &value) {
+        std::lock_guard lock(m_Mutex);
+        return Write(key, [&value](IConfigVariableBase &variable) { return variable.TrySetJson(value); });
+    }
+
+    // like CConfigRegistry::SetNested, the first nested write copies the base value
+    std::expected<void, std::string> SetNested(CConfigKey key, std::string_view path, const json &value) {
+        std::lock_guard lock(m_Mutex);
+        return Write(key, [path, &value](IConfigVariableBase &variable) { return variable.SetNested(path, value); });
+    }
+
+    // drops the override, key reads the base value again
+    bool Reset(CConfigKey key) {
+        std::lock_guard lock(m_Mutex);
+        const auto overrides = m_pOverrides.load(std::memory_order_acquire);
+        if (!overrides->contains(key.Name()))
+            return false;
+
+        auto copy = std::make_shared<Overrides>(*overrides);
+        copy->erase(copy->find(key.Name()));
+        m_pOverrides.store(std::move(copy), std::memory_order_release);
+        return true;
+    }
+
+    void ResetAll() {
+        std::lock_guard lock(m_Mutex);
+        m_pOverrides.store(std::make_shared<const Overrides>(), std::memory_order_release);
+    }
+};
+
+#endif // CONFIG_OVERLAY_H
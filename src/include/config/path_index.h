@@ -0,0 +1,169 @@
+#ifndef CONFIG_PATH_INDEX_H
+#define CONFIG_PATH_INDEX_H
+
+#include <map>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+
+#include <config/external/json.hpp>
+
+#include "table.h"
+
+using namespace nlohmann;
+
+// trie over the dotted names of registered variables
+// every path segment is stored once, loads and saves walk it together with the json tree
+class CPathIndex {
+public:
+    struct SNode {
+        const CVariableTable::SEntry *m_pEntry = nullptr;
+        std::map<std::string, std::unique_ptr<SNode>, std::less<> > m_Children;
+
+        const SNode *Child(std::string_view Segment) const {
+            const auto it = m_Children.find(Segment);
+            return it == m_Children.end() ? nullptr : it->second.get();
+        }
+    };
+
+private:
+    SNode m_Root;
+
+    template<typename F>
+    static void Split(std::string_view Path, F &&Func) {
+        size_t start = 0;
+        for (size_t end = Path.find('.'); end != std::string_view::npos; end = Path.find('.', start)) {
+            if (!Func(Path.substr(start, end - start), false))
+                return;
+            start = end + 1;
+        }
+        Func(Path.substr(start), true);
+    }
+
+    template<typename F>
+    static void Visit(const SNode &Node, F &Func) {
+        if (Node.m_pEntry)
+            Func(*Node.m_pEntry);
+        for (const auto &child: Node.m_Children | std::views::values)
+            Visit(*child, Func);
+    }
+
+    template<typename J, typename F>
+    static void Match(const SNode &Node, J &Value, F &Func) {
+        if (!Value.is_object())
+            return;
+
+        for (const auto &[segment, child]: Node.m_Children) {
+            const auto it = Value.find(segment);
+            if (it == Value.end())
+                continue;
+            if (child->m_pEntry)
+                Func(*child->m_pEntry, *it);
+            if (!child->m_Children.empty())
+                Match(*child, *it, Func);
+        }
+    }
+
+    template<typename F>
+    static void Build(const SNode &Node, json &Out, F &Func) {
+        for (const auto &[segment, child]: Node.m_Children) {
+            if (child->m_pEntry) {
+                Out[segment] = Func(*child->m_pEntry);
+            } else {
+                json &object = Out[segment] = json::object();
+                Build(*child, object, Func);
+            }
+        }
+    }
+
+public:
+    const SNode &Root() const { return m_Root; }
+
+    void Insert(const CVariableTable::SEntry &Entry) {
+        SNode *pNode = &m_Root;
+        Split(Entry.m_Name, [&pNode](std::string_view Segment, bool) {
+            auto it = pNode->m_Children.find(Segment);
+            if (it == pNode->m_Children.end())
+                it = pNode->m_Children.emplace(std::string(Segment), std::make_unique<SNode>()).first;
+            pNode = it->second.get();
+            return true;
+        });
+        pNode->m_pEntry = &Entry;
+    }
+
+    const SNode *Find(std::string_view Path) const {
+        const SNode *pNode = &m_Root;
+        Split(Path, [&pNode](std::string_view Segment, bool) {
+            pNode = pNode->Child(Segment);
+            return pNode != nullptr;
+        });
+        return pNode;
+    }
+
+    // value stored under the dotted path, without copying it
+    static const json *Lookup(const json &Root, std::string_view Path) {
+        const json *pCurrent = &Root;
+        Split(Path, [&pCurrent](std::string_view Segment, bool) {
+            if (!pCurrent->is_object()) {
+                pCurrent = nullptr;
+                return false;
+            }
+            const auto it = pCurrent->find(Segment);
+            pCurrent = it == pCurrent->end() ? nullptr : &*it;
+            return pCurrent != nullptr;
+        });
+        return pCurrent;
+    }
+
+    // visits all variables grouped by prefix, in the order a saved document lists them
+    template<typename F>
+    void ForEach(F &&Func) const {
+        Visit(m_Root, Func);
+    }
+
+    // calls Func(entry, value) for every registered variable present in the tree, in one pass
+    // with a mutable tree Func may move the values out
+    template<typename J, typename F>
+    void Match(J &Root, F &&Func) const {
+        Match(m_Root, Root, Func);
+    }
+
+    // builds the nested tree of all variables, Func(entry) returns the json to store for each of them
+    template<typename F>
+    json Build(F &&Func) const {
+        json root = json::object();
+        Build(m_Root, root, Func);
+        return root;
+    }
+
+    // visits the variables at Path and below it, an empty path visits all of them
+    template<typename F>
+    void ForEachBelow(std::string_view Path, F &&Func) const {
+        if (const SNode *pNode = Path.empty() ? &m_Root : Find(Path))
+            Visit(*pNode, Func);
+    }
+
+    // visits the variables a change at Path can affect: on the way to it, at it and below it
+    template<typename F>
+    void ForEachAffected(std::string_view Path, F &&Func) const {
+        if (const SNode *pNode = ForEachOwner(Path, Func))
+            Visit(*pNode, Func);
+    }
+
+    // visits the variables whose value holds Path, the ones on the way to it
+    // returns the node at Path, nullptr if it isn't part of the index
+    template<typename F>
+    const SNode *ForEachOwner(std::string_view Path, F &&Func) const {
+        const SNode *pNode = &m_Root;
+        Split(Path, [&](std::string_view Segment, bool Last) {
+            pNode = pNode->Child(Segment);
+            if (pNode && pNode->m_pEntry && !Last)
+                Func(*pNode->m_pEntry);
+            return pNode != nullptr;
+        });
+        return pNode;
+    }
+};
+
+#endif // CONFIG_PATH_INDEX_H
@@ -1,182 +1,820 @@
 #ifndef CONFIG_REGISTRY_H
 #define CONFIG_REGISTRY_H
 
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <ranges>
+#include <span>
 #include <string>
-#include <unordered_map>
-#include <fstream>
+#include <iterator>
+#include <thread>
 
 #include <config/external/json.hpp>
 
+#include "async.h"
+#include "binary.h"
+#include "info.h"
+#include "layers.h"
+#include "metrics.h"
+#include "path_index.h"
+#include "sax_loader.h"
+#include "table.h"
+#include "value_store.h"
 #include "variable.h"
+#include "writer.h"
 
 using namespace nlohmann;
 
+class CConfigTransaction;
+class CConfigScope;
+class CConfigOverlay;
+
 class CConfigRegistry {
-    std::unordered_map<std::string, std::unique_ptr<IConfigVariableBase> > m_Variables;
+    friend class CConfigScope;
+    friend class CConfigOverlay;
+
+    // readers go through the lock-free table, m_Mutex only serializes writers
+    CVariableTable m_Variables;
+    // pre-split names of all variables, only touched under m_Mutex
+    CPathIndex m_Paths;
+    // the values themselves, packed by type
+    CValueStore m_Values;
     mutable std::mutex m_Mutex;
+    // empty unless built with CONFIG_ENABLE_METRICS
+    mutable CConfigMetrics m_Metrics;
+    // read by every CConfigHandle::Cached(), kept away from the lock so writers don't evict it as often
+    alignas(64) std::atomic<uint64_t> m_Generation = FirstGeneration();
+    // odd while a batch is being stored, lets ReadConsistent retry instead of seeing half of it
+    std::atomic<uint64_t> m_Sequence = 0;
     std::string m_ConfigPath;
+    // tree applied by the last ReloadFromFile, diffed against on the next one
+    std::optional<json> m_LastApplied;
+    // variables a lazy load deferred, checked by ValidateAll
+    std::vector<const CVariableTable::SEntry *> m_Deferred;
+    // threads used to convert and validate values on load, 1 keeps everything on the calling thread
+    unsigned m_LoadThreads = 1;
+    // sources added with AddLayer, only touched under m_Mutex
+    CConfigLayers m_Layers;
+    // handed out to async loads in submission order, m_AsyncApplied is the newest one stored
+    std::atomic<uint64_t> m_AsyncTickets = 0;
+    uint64_t m_AsyncApplied = 0;
+
+    using Assignment = std::pair<const CVariableTable::SEntry *, const json *>;
+
+    // every registry counts from its own range, a thread's Cached() slot left behind by a destroyed registry
+    // never matches a new one that got the same address
+    static uint64_t FirstGeneration() {
+        static std::atomic<uint64_t> s_Registries = 0;
+        return s_Registries.fetch_add(1, std::memory_order_relaxed) << 40;
+    }
 
-    CConfigRegistry() = default;
+    void BumpGeneration() { m_Generation.fetch_add(1, std::memory_order_release); }
 
     // json helpers
 
-    json &GetNestedJson(json &root, const std::string &path) {
-        size_t start = 0;
-        size_t end = path.find('.');
-        json *current = &root;
+    // parsed straight from the mapped file, a missing file fails on open without probing for it first
+    std::expected<json, std::string> ReadJsonFile(const std::string &filepath) {
+        CMappedFile file;
+        if (auto opened = file.Open(filepath); !opened.has_value())
+            return std::unexpected(opened.error());
+        return ParseBuffer(file.Data());
+    }
+
+    // runs Func(i) for every i below count, split into contiguous chunks over up to m_LoadThreads threads
+    template<typename F>
+    void ParallelFor(size_t count, F &&Func) const {
+        static constexpr size_t s_MinChunk = 256;
+        const size_t threads = std::min<size_t>(m_LoadThreads, (count + s_MinChunk - 1) / s_MinChunk);
+        if (threads <= 1) {
+            for (size_t i = 0; i < count; ++i)
+                Func(i);
+            return;
+        }
+
+        const size_t chunk = (count + threads - 1) / threads;
+        auto run = [&Func, count, chunk](size_t first) {
+            for (size_t i = first; i < std::min(count, first + chunk); ++i)
+                Func(i);
+        };
+
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t)
+            workers.emplace_back(run, t * chunk);
+        run(0);
+    }
+
+    // called with the writer lock held around stores to more than one variable, see ReadConsistent
+    template<typename F>
+    void PublishBatch(F &&stores) {
+        const uint64_t sequence = m_Sequence.load(std::memory_order_relaxed);
+        m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        stores();
+        m_Sequence.store(sequence + 2, std::memory_order_release);
+    }
 
-        while (end != std::string::npos) {
-            std::string part = path.substr(start, end - start);
-            if (!current->contains(part) || !(*current)[part].is_object()) {
-                (*current)[part] = json::object();
+    // called with the writer lock held, stores the staged values of entries and records the ones that changed
+    void CommitStaged(const std::vector<const CVariableTable::SEntry *> &entries, std::vector<std::string> &changed) {
+        PublishBatch([&] {
+            for (const auto *entry: entries) {
+                const uint64_t revision = entry->m_Variable->Revision();
+                entry->m_Variable->CommitStaged();
+                if (entry->m_Variable->Revision() != revision)
+                    changed.push_back(entry->m_Name);
+            }
+        });
+    }
+
+    // called with the writer lock held, values are converted in parallel and stored once all of them are done
+    // errors keep the order of assignments
+    void ApplyAll(const std::vector<Assignment> &assignments, std::vector<std::string> &errors,
+                  std::vector<std::string> &changed) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_APPLY);
+        std::vector<std::string> failures(assignments.size());
+        ParallelFor(assignments.size(), [&](size_t i) {
+            const auto &[entry, value] = assignments[i];
+            try {
+                if (auto result = entry->m_Variable->StageJson(*value, true); !result.has_value())
+                    failures[i] = result.error();
+            } catch (const std::exception &e) {
+                failures[i] = e.what();
+            }
+        });
+
+        std::vector<const CVariableTable::SEntry *> staged;
+        staged.reserve(assignments.size());
+        for (size_t i = 0; i < assignments.size(); ++i) {
+            if (failures[i].empty()) {
+                staged.push_back(assignments[i].first);
+            } else {
+                errors.push_back(assignments[i].first->m_Name + ": " + failures[i]);
+                m_Metrics.ValidationFailed(assignments[i].first->m_Name);
             }
-            current = &(*current)[part];
-            start = end + 1;
-            end = path.find('.', start);
         }
+        CommitStaged(staged, changed);
+    }
 
-        return *current;
+    using LayerWinners = std::vector<std::optional<std::string> >;
+
+    // called with the writer lock held before a layer changes, what the layers hold for the read-only
+    // variables among names, nullopt for all other names
+    LayerWinners ReadOnlyWinners(const std::vector<std::string> &names) const {
+        LayerWinners winners(names.size());
+        for (size_t i = 0; i < names.size(); ++i) {
+            const auto *entry = m_Variables.Find(names[i]);
+            if (!entry || !entry->m_Variable->ReadOnly())
+                continue;
+            if (const std::string *pValue = m_Layers.Effective(names[i]))
+                winners[i] = *pValue;
+        }
+        return winners;
     }
 
-    void SetNestedValue(json &root, const std::string &path, const json &value) {
-        size_t lastDot = path.rfind('.');
-        if (lastDot == std::string::npos) {
-            root[path] = value;
-        } else {
-            std::string parentPath = path.substr(0, lastDot);
-            std::string key = path.substr(lastDot + 1);
-            json &parent = GetNestedJson(root, parentPath);
-            parent[key] = value;
+    // called with the writer lock held, stages what the layers now hold for names and stores all of it or nothing
+    // names no layer holds go back to their default, names of unregistered variables are skipped
+    // pReadOnly is nullptr for the first fill of a layer, which may set read-only variables like a load does
+    // otherwise it holds ReadOnlyWinners(names) from before the change, and a read-only variable whose
+    // winner moved fails like Set() does
+    std::expected<void, std::string> ApplyLayers(const std::vector<std::string> &names, std::vector<std::string> &changed,
+                                                 const LayerWinners *pReadOnly) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_APPLY);
+        std::vector<const CVariableTable::SEntry *> staged;
+        std::vector<std::string> errors;
+        for (size_t i = 0; i < names.size(); ++i) {
+            const auto &name = names[i];
+            const auto *entry = m_Variables.Find(name);
+            if (!entry)
+                continue;
+
+            const std::string *pValue = m_Layers.Effective(name);
+            if (pReadOnly && entry->m_Variable->ReadOnly()) {
+                const auto &before = (*pReadOnly)[i];
+                if (before.has_value() != (pValue != nullptr) || (pValue && *before != *pValue))
+                    errors.push_back(entry->m_Name + ": Variable is read-only");
+                continue;
+            }
+
+            staged.push_back(entry);
+            if (!pValue) {
+                entry->m_Variable->StageDefault();
+            } else if (auto result = entry->m_Variable->Stage(*pValue, !pReadOnly); !result.has_value()) {
+                errors.push_back(entry->m_Name + ": " + result.error());
+                m_Metrics.ValidationFailed(entry->m_Name);
+            }
+        }
+
+        if (!errors.empty()) {
+            for (const auto *entry: staged)
+                entry->m_Variable->DiscardStaged();
+            return JoinErrors(errors, "Nothing was applied, some values are invalid:");
         }
+
+        CommitStaged(staged, changed);
+        return {};
     }
 
-    std::optional<json> GetNestedValue(const json &root, const std::string &path) const {
-        size_t start = 0;
-        size_t end = path.find('.');
-        const json *current = &root;
+    // called with the writer lock held, swaps the values of layer and restages the names whose value changed
+    std::expected<void, std::string> ReplaceLayer(std::string_view layer, CConfigLayers::Values values,
+                                                  std::vector<std::string> &changed) {
+        const CConfigLayers::Values *pCurrent = m_Layers.Find(layer);
+        if (!pCurrent)
+            return std::unexpected("Layer '" + std::string(layer) + "' not found");
+
+        const std::vector<std::string> names = CConfigLayers::Diff(*pCurrent, values);
+        const bool init = !m_Layers.Filled(layer);
+        const LayerWinners before = init ? LayerWinners() : ReadOnlyWinners(names);
+        auto previous = m_Layers.Replace(layer, std::move(values));
+
+        auto result = ApplyLayers(names, changed, init ? nullptr : &before);
+        if (result.has_value())
+            m_Layers.MarkFilled(layer);
+        else
+            m_Layers.Replace(layer, std::move(*previous));
+        Commit(changed);
+        return result;
+    }
 
-        while (end != std::string::npos) {
-            std::string part = path.substr(start, end - start);
-            if (!current->contains(part))
-                return std::nullopt;
-            current = &(*current)[part];
-            start = end + 1;
-            end = path.find('.', start);
+    // applies the variables whose value differs from m_LastApplied, or all of them on the first reload
+    void ApplyDiff(const json &root, std::vector<std::string> &errors, std::vector<std::string> &changed) {
+        std::vector<Assignment> assignments;
+        if (!m_LastApplied.has_value()) {
+            m_Paths.Match(root, [&assignments](const CVariableTable::SEntry &entry, const json &value) {
+                assignments.emplace_back(&entry, &value);
+            });
+            ApplyAll(assignments, errors, changed);
+            return;
         }
 
-        std::string finalKey = path.substr(start);
-        if (!current->contains(finalKey))
-            return std::nullopt;
+        const json patch = json::diff(*m_LastApplied, root);
+        if (patch.empty())
+            return;
+
+        std::vector<const CVariableTable::SEntry *> dirty;
+        for (const auto &op: patch) {
+            const auto mark = [&dirty](const CVariableTable::SEntry &entry) { dirty.push_back(&entry); };
+            const std::string name = PointerToName(op["path"].get<std::string>());
+
+            // a removal only matters inside a list, map or struct value, removed variables keep their value
+            // other changes may sit inside a variable's value or replace a whole subtree of variables
+            if (op["op"] == "remove")
+                m_Paths.ForEachOwner(name, mark);
+            else
+                m_Paths.ForEachAffected(name, mark);
+        }
+
+        std::ranges::sort(dirty);
+        const auto [first, last] = std::ranges::unique(dirty);
+        dirty.erase(first, last);
+
+        for (const auto *entry: dirty) {
+            if (const json *value = CPathIndex::Lookup(root, entry->m_Name))
+                assignments.emplace_back(entry, value);
+        }
+        ApplyAll(assignments, errors, changed);
+    }
 
-        return (*current)[finalKey];
+    // called with the writer lock held
+    void Commit(const std::vector<std::string> &changed) {
+        if (!changed.empty())
+            BumpGeneration();
+    }
+
+    static bool MatchesKey(std::string_view name, std::string_view key) {
+        if (key.empty() || name == key)
+            return true;
+        return name.starts_with(key) && (key.back() == '.' || name[key.size()] == '.');
+    }
+
+    // called after the writer lock is released, one batch per subscriber
+    void Notify(const std::vector<std::string> &changed) {
+        if (changed.empty())
+            return;
+
+        std::vector<std::function<void()> > tasks;
+        Executor executor;
+        {
+            std::lock_guard lock(m_SubscriptionMutex);
+            for (const auto &sub: m_Subscriptions) {
+                std::vector<std::string> batch;
+                for (const auto &name: changed) {
+                    if (MatchesKey(name, sub.m_Key))
+                        batch.push_back(name);
+                }
+                if (!batch.empty())
+                    tasks.emplace_back([callback = sub.m_Callback, batch = std::move(batch)] { callback(batch); });
+            }
+            executor = m_Executor;
+        }
+
+        for (auto &task: tasks) {
+            if (executor)
+                executor(std::move(task));
+            else
+                task();
+        }
+    }
+
+    static std::expected<void, std::string> JoinErrors(const std::vector<std::string> &errors,
+                                                       std::string_view header = "Some variables failed to load:") {
+        if (errors.empty())
+            return {};
+
+        std::string errorMsg = std::string(header) + "\n";
+        for (const auto &err: errors)
+            errorMsg += " - " + err + "\n";
+        return std::unexpected(errorMsg);
+    }
+
+    // names and types of all registered variables, binary snapshots are only loaded into the same set
+    uint64_t SchemaHash() const {
+        uint64_t hash = 0;
+        m_Variables.ForEach([&hash](const CVariableTable::SEntry &entry) {
+            hash += BinarySchemaTerm(entry.m_Hash, BinaryTypeOf(*entry.m_Variable));
+        });
+        return hash;
+    }
+
+    // variable behind entry if it holds a T, nullptr if there is no entry or its type differs
+    template<typename T>
+    static CConfigVariable<T> *As(const CVariableTable::SEntry *entry) {
+        return entry ? dynamic_cast<CConfigVariable<T> *>(entry->m_Variable.get()) : nullptr;
+    }
+
+    // "/net/http/port" -> "net.http.port"
+    static std::string PointerToName(const std::string &pointer) {
+        std::string name;
+        name.reserve(pointer.size());
+        for (size_t i = 1; i < pointer.size(); ++i) {
+            if (pointer[i] == '/') {
+                name += '.';
+            } else if (pointer[i] == '~' && i + 1 < pointer.size()) {
+                name += pointer[++i] == '1' ? '/' : '~';
+            } else {
+                name += pointer[i];
+            }
+        }
+        return name;
+    }
+
+    using Snapshot = std::vector<std::pair<std::string_view, json> >;
+
+    // called with the writer lock held, names point into the table and stay valid
+    template<typename F>
+    Snapshot TakeSnapshot(F &&valueOf) const {
+        std::vector<const CVariableTable::SEntry *> entries;
+        entries.reserve(m_Variables.Size());
+        m_Paths.ForEach([&entries](const CVariableTable::SEntry &entry) { entries.push_back(&entry); });
+
+        Snapshot snapshot(entries.size());
+        ParallelFor(entries.size(), [&](size_t i) {
+            snapshot[i] = {entries[i]->m_Name, valueOf(*entries[i]->m_Variable)};
+        });
+        return snapshot;
+    }
+
+    // current values of all variables, taken under the writer lock
+    Snapshot ValueSnapshot() const {
+        CMeasuredLock lock(m_Mutex, m_Metrics);
+        return TakeSnapshot([](const IConfigVariableBase &var) { return var.ValueAsJson(); });
+    }
+
+    template<typename Sink>
+    static void WriteSnapshotTo(Sink &sink, const Snapshot &snapshot, int indent) {
+        CJsonWriter writer(sink, indent);
+        for (const auto &[name, value]: snapshot)
+            writer.Member(name, value);
+        writer.Finish();
+    }
+
+    // streams the snapshot into a temporary file and renames it over the target
+    std::expected<void, std::string> WriteSnapshot(const std::string &filepath, const Snapshot &snapshot, int indent) {
+        CAtomicFile file(filepath);
+        if (!file.Ok())
+            return file.Commit();
+
+        WriteSnapshotTo(file, snapshot, indent);
+        m_Metrics.BytesWritten(file.Written());
+        return file.Commit();
     }
 
 public:
+    using SubscriptionId = uint64_t;
+    using ChangeCallback = std::function<void(const std::vector<std::string> &)>;
+    using Executor = std::function<void(std::function<void()>)>;
+
+private:
+    struct SSubscription {
+        SubscriptionId m_Id;
+        std::string m_Key;
+        ChangeCallback m_Callback;
+    };
+
+    std::mutex m_SubscriptionMutex;
+    std::vector<SSubscription> m_Subscriptions;
+    SubscriptionId m_NextSubscription = 1;
+    Executor m_Executor;
+    // runs async loads, guarded by m_SubscriptionMutex like m_Executor
+    Executor m_LoadExecutor;
+
+    // json::parse with the errors ReadJsonFile reports, called without any lock held
+    std::expected<json, std::string> ParseBuffer(std::span<const char> buffer) {
+        try {
+            [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_PARSE);
+            json root = json::parse(buffer.begin(), buffer.end());
+            m_Metrics.BytesRead(buffer.size());
+            return root;
+        } catch (const json::exception &e) {
+            return std::unexpected("JSON parse error: " + std::string(e.what()));
+        } catch (const std::exception &e) {
+            return std::unexpected("Error loading config: " + std::string(e.what()));
+        }
+    }
+
+    // called with the writer lock held, false if a newer async load than ticket was already stored
+    // ticket 0 is a synchronous load, those always apply
+    bool ClaimTicket(uint64_t ticket) {
+        if (ticket == 0)
+            return true;
+        if (ticket < m_AsyncApplied)
+            return false;
+        m_AsyncApplied = ticket;
+        return true;
+    }
+
+    // the part of LoadFromFile after parsing
+    std::expected<void, std::string> LoadDocument(const json &root, uint64_t ticket = 0) {
+        std::vector<std::string> errors;
+        std::vector<std::string> changed;
+
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            if (!ClaimTicket(ticket))
+                return std::unexpected("Superseded by a newer load");
+
+            std::vector<Assignment> assignments;
+            m_Paths.Match(root, [&assignments](const CVariableTable::SEntry &entry, const json &value) {
+                assignments.emplace_back(&entry, &value);
+            });
+            ApplyAll(assignments, errors, changed);
+            // the next reload has to compare against everything, not just this document
+            m_LastApplied.reset();
+            Commit(changed);
+        }
+
+        Notify(changed);
+        return JoinErrors(errors);
+    }
+
+    // the part of ReloadFromFile after parsing
+    std::expected<void, std::string> ReloadDocument(json root, uint64_t ticket = 0) {
+        std::vector<std::string> errors;
+        std::vector<std::string> changed;
+
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            if (!ClaimTicket(ticket))
+                return std::unexpected("Superseded by a newer load");
+
+            ApplyDiff(root, errors, changed);
+            m_LastApplied = std::move(root);
+            Commit(changed);
+        }
+
+        Notify(changed);
+        return JoinErrors(errors);
+    }
+
+    CAsyncLoad RunAsync(std::string buffer, bool reload) {
+        CAsyncLoad load;
+        const uint64_t ticket = m_AsyncTickets.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto task = [this, load, ticket, reload, buffer = std::move(buffer)] {
+            try {
+                [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+                auto root = ParseBuffer(buffer);
+                if (!root.has_value())
+                    load.Complete(std::unexpected(root.error()));
+                else if (reload)
+                    load.Complete(ReloadDocument(std::move(*root), ticket));
+                else
+                    load.Complete(LoadDocument(*root, ticket));
+            } catch (const std::exception &e) {
+                load.Complete(std::unexpected("Error loading config: " + std::string(e.what())));
+            }
+        };
+
+        Executor executor;
+        {
+            std::lock_guard lock(m_SubscriptionMutex);
+            executor = m_LoadExecutor;
+        }
+        if (executor)
+            executor(std::move(task));
+        else
+            std::thread(std::move(task)).detach();
+        return load;
+    }
+
+public:
+    // independent registries, e.g. one per tenant, Instance() is the process wide one
+    // a registry has to outlive its handles and the asynchronous loads started on it
+    CConfigRegistry() = default;
+
+    CConfigRegistry(const CConfigRegistry &) = delete;
+    CConfigRegistry &operator=(const CConfigRegistry &) = delete;
+
     static CConfigRegistry &Instance() {
         static CConfigRegistry instance;
         return instance;
     }
 
     void SetConfigPath(const std::string &path) {
-        std::lock_guard lock(m_Mutex);
+        CMeasuredLock lock(m_Mutex, m_Metrics);
         m_ConfigPath = path;
     }
 
+    // values of a load are converted and validated on up to threads threads, then stored together
+    // custom validators have to be safe to call concurrently for different variables once this is above 1
+    void SetLoadThreads(unsigned threads) {
+        CMeasuredLock lock(m_Mutex, m_Metrics);
+        m_LoadThreads = std::max(threads, 1u);
+    }
+
+    // lock, latency, traffic and validation failure statistics, Metrics().Prometheus() renders them
+    // all of it compiles away unless CONFIG_ENABLE_METRICS is defined
+    const CConfigMetrics &Metrics() const { return m_Metrics; }
+
+    // bumped after every committed write, lets readers detect that something changed
+    uint64_t Generation() const { return m_Generation.load(std::memory_order_acquire); }
+
     std::string GetConfigPath() const {
-        std::lock_guard lock(m_Mutex);
+        CMeasuredLock lock(m_Mutex, m_Metrics);
         return m_ConfigPath;
     }
 
+    // returns an invalid handle if the name is already taken
     template<typename T>
-    bool Register(CConfigVariable<T> &&var) {
-        std::lock_guard lock(m_Mutex);
+    CConfigHandle<T> Register(CConfigVariable<T> &&var) {
+        CMeasuredLock lock(m_Mutex, m_Metrics);
         const std::string name(var.Name());
 
-        if (m_Variables.contains(name))
-            return false;
+        if (m_Variables.Contains(name))
+            return {};
 
-        m_Variables[name] = std::make_unique<CConfigVariable<T> >(std::move(var));
-        return true;
+        auto wrapper = std::make_unique<CConfigVariable<T> >(std::move(var));
+        wrapper->BindCell(m_Values.Pool<T>().Allocate(wrapper->Name(), wrapper->Value(), wrapper->DefaultValue()));
+        CConfigHandle<T> handle(*wrapper, &m_Generation);
+        m_Paths.Insert(m_Variables.Insert(name, std::move(wrapper)));
+        BumpGeneration();
+        return handle;
     }
 
     template<typename T>
-    std::optional<T> Get(const std::string &name) const {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
-            return std::nullopt;
+    CConfigHandle<T> Handle(CConfigKey key) const {
+        auto *wrapper = As<T>(m_Variables.Find(key));
+        if (!wrapper)
+            return {};
+
+        return CConfigHandle<T>(*wrapper, &m_Generation);
+    }
 
-        auto *wrapper = dynamic_cast<CConfigVariable<T> *>(it->second.get());
+    template<typename T>
+    std::optional<T> Get(CConfigKey key) const {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_GET);
+        auto *wrapper = As<T>(m_Variables.Find(key));
         if (!wrapper)
             return std::nullopt;
 
         return wrapper->Value();
     }
 
+    // like Get, but hands out the stored string, list or struct instead of a copy, see CConfigHandle::Shared
     template<typename T>
-    std::optional<T> Type(const std::string &name) const {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
-            return std::nullopt;
+    std::shared_ptr<const T> GetShared(CConfigKey key) const requires (!IsInlineValue<T>()) {
+        auto *wrapper = As<T>(m_Variables.Find(key));
+        if (!wrapper)
+            return nullptr;
+
+        return wrapper->SharedValue();
+    }
 
-        auto *wrapper = dynamic_cast<CConfigVariable<T> *>(it->second.get());
+    template<typename T>
+    std::optional<T> Type(CConfigKey key) const {
+        auto *wrapper = As<T>(m_Variables.Find(key));
         if (!wrapper)
             return std::nullopt;
 
         return wrapper->Value();
     }
 
-    std::expected<void, std::string> Set(const std::string &name, const std::string &value) {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
-            return std::unexpected("Variable '" + name + "' not found");
+    std::expected<void, std::string> Set(CConfigKey key, std::string_view value) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SET);
+        std::vector<std::string> changed;
+        std::expected<void, std::string> result;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            const auto *entry = m_Variables.Find(key);
+            if (!entry)
+                return std::unexpected("Variable '" + std::string(key.Name()) + "' not found");
+
+            const uint64_t revision = entry->m_Variable->Revision();
+            result = entry->m_Variable->TrySet(value);
+            if (!result.has_value())
+                m_Metrics.ValidationFailed(entry->m_Name);
+            if (entry->m_Variable->Revision() != revision)
+                changed.push_back(entry->m_Name);
+            Commit(changed);
+        }
 
-        return it->second->TrySet(value);
+        Notify(changed);
+        return result;
     }
 
-    bool Exists(const std::string &name) const {
-        std::lock_guard lock(m_Mutex);
-        return m_Variables.contains(name);
+    // updates one element of a list, map or struct variable: SetNested("upstream.hosts", "/2", "10.0.0.3")
+    // only that element is converted, subscribers of the variable are notified like for Set()
+    std::expected<void, std::string> SetNested(CConfigKey key, std::string_view path, const json &value) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SET);
+        std::vector<std::string> changed;
+        std::expected<void, std::string> result;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            const auto *entry = m_Variables.Find(key);
+            if (!entry)
+                return std::unexpected("Variable '" + std::string(key.Name()) + "' not found");
+
+            const uint64_t revision = entry->m_Variable->Revision();
+            result = entry->m_Variable->SetNested(path, value);
+            if (!result.has_value())
+                m_Metrics.ValidationFailed(entry->m_Name);
+            if (entry->m_Variable->Revision() != revision)
+                changed.push_back(entry->m_Name);
+            Commit(changed);
+        }
+
+        Notify(changed);
+        return result;
     }
 
-    std::optional<std::string> GetAsString(const std::string &name) const {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
+    // validates every value first and stores them under one lock only if all of them passed
+    // readers going through ReadConsistent see either none or all of the batch
+    std::expected<void, std::string> SetMany(std::span<const std::pair<std::string_view, std::string_view> > values) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SET);
+        std::vector<std::string> errors;
+        std::vector<std::string> changed;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            std::vector<const CVariableTable::SEntry *> staged;
+            staged.reserve(values.size());
+            for (const auto &[name, value]: values) {
+                const auto *entry = m_Variables.Find(name);
+                if (!entry) {
+                    errors.push_back("Variable '" + std::string(name) + "' not found");
+                    continue;
+                }
+
+                staged.push_back(entry);
+                if (auto result = entry->m_Variable->Stage(value); !result.has_value()) {
+                    errors.push_back(entry->m_Name + ": " + result.error());
+                    m_Metrics.ValidationFailed(entry->m_Name);
+                }
+            }
+
+            if (!errors.empty()) {
+                for (const auto *entry: staged)
+                    entry->m_Variable->DiscardStaged();
+                return JoinErrors(errors, "Nothing was applied, some values are invalid:");
+            }
+
+            CommitStaged(staged, changed);
+            Commit(changed);
+        }
+
+        Notify(changed);
+        return {};
+    }
+
+    CConfigTransaction Transaction();
+
+    // calls Func until no batch write overlapped it, so several reads in it observe one configuration
+    // Func may run more than once and should only read
+    template<typename F>
+    auto ReadConsistent(F &&Func) const {
+        for (;;) {
+            const uint64_t before = m_Sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if constexpr (std::is_void_v<std::invoke_result_t<F &> >) {
+                Func();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_Sequence.load(std::memory_order_relaxed) == before)
+                    return;
+            } else {
+                auto result = Func();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_Sequence.load(std::memory_order_relaxed) == before)
+                    return result;
+            }
+        }
+    }
+
+    bool Exists(CConfigKey key) const {
+        return m_Variables.Contains(key);
+    }
+
+    std::optional<std::string> GetAsString(CConfigKey key) const {
+        const auto *entry = m_Variables.Find(key);
+        if (!entry)
             return std::nullopt;
-        return it->second->ValueAsString();
+        return entry->m_Variable->ValueAsString();
     }
 
-    bool Reset(const std::string &name) {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
-            return false;
-        it->second->Reset();
+    bool Reset(CConfigKey key) {
+        std::vector<std::string> changed;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            const auto *entry = m_Variables.Find(key);
+            if (!entry)
+                return false;
+
+            const uint64_t revision = entry->m_Variable->Revision();
+            entry->m_Variable->Reset();
+            if (entry->m_Variable->Revision() != revision)
+                changed.push_back(entry->m_Name);
+            Commit(changed);
+        }
+
+        Notify(changed);
         return true;
     }
 
     void ResetAll(const std::string &name) {
-        std::lock_guard lock(m_Mutex);
-        for (const auto &var: m_Variables | std::views::values) {
-            var->Reset();
+        std::vector<std::string> changed;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            for (const auto *entry: m_Deferred)
+                entry->m_Variable->DropDeferred();
+            m_Deferred.clear();
+            PublishBatch([&] { m_Values.ResetAll(changed); });
+            Commit(changed);
         }
+
+        Notify(changed);
+    }
+
+    // subscriptions
+    // key is a variable name, a prefix ("net" or "net." matches "net.port") or empty for everything
+    // the callback gets every matching name a single write changed, it never runs under the registry locks
+
+    SubscriptionId Subscribe(std::string key, ChangeCallback callback) {
+        std::lock_guard lock(m_SubscriptionMutex);
+        const SubscriptionId id = m_NextSubscription++;
+        m_Subscriptions.push_back({id, std::move(key), std::move(callback)});
+        return id;
+    }
+
+    bool Unsubscribe(SubscriptionId id) {
+        std::lock_guard lock(m_SubscriptionMutex);
+        return std::erase_if(m_Subscriptions, [id](const SSubscription &sub) { return sub.m_Id == id; }) > 0;
+    }
+
+    // callbacks run inline on the writing thread unless an executor is set
+    void SetExecutor(Executor executor) {
+        std::lock_guard lock(m_SubscriptionMutex);
+        m_Executor = std::move(executor);
     }
 
     std::vector<std::string> ListAll() const {
-        std::lock_guard lock(m_Mutex);
         std::vector<std::string> names;
-        names.reserve(m_Variables.size());
-        for (const auto &name: m_Variables | std::views::keys)
-            names.push_back(name);
+        names.reserve(m_Variables.Size());
+        m_Variables.ForEach([&names](const CVariableTable::SEntry &entry) {
+            names.push_back(entry.m_Name);
+        });
         return names;
     }
 
+    // names at prefix and below it, "net.http" and "net.http." both match "net.http.port"
+    // walks only the matching part of the path index, the views point into the table and stay valid
+    std::vector<std::string_view> ListPrefix(std::string_view prefix) const {
+        if (prefix.ends_with('.'))
+            prefix.remove_suffix(1);
+
+        std::vector<std::string_view> names;
+        CMeasuredLock lock(m_Mutex, m_Metrics);
+        m_Paths.ForEachBelow(prefix, [&names](const CVariableTable::SEntry &entry) { names.push_back(entry.m_Name); });
+        return names;
+    }
+
+    // view of the variables below prefix that takes names relative to it, see CConfigScope
+    CConfigScope Scope(std::string_view prefix);
+
     struct VariableInfo {
         bool readonly = false;
         std::string name;
@@ -186,49 +824,85 @@ public:
         std::optional<std::string> description;
     };
 
-    std::optional<VariableInfo> GetInfo(const std::string &name) const {
-        std::lock_guard lock(m_Mutex);
-        const auto it = m_Variables.find(name);
-        if (it == m_Variables.end())
+    std::optional<VariableInfo> GetInfo(CConfigKey key) const {
+        const auto *entry = m_Variables.Find(key);
+        if (!entry)
             return std::nullopt;
 
         VariableInfo info;
-        info.readonly = it->second->ReadOnly();
-        info.name = std::string(it->second->Name());
-        info.type = it->second->TypeString();
-        info.value = it->second->ValueAsString();
-        info.default_value = it->second->DefaultValueAsString();
-        if (const auto desc = it->second->Description())
+        info.readonly = entry->m_Variable->ReadOnly();
+        info.name = std::string(entry->m_Variable->Name());
+        info.type = entry->m_Variable->TypeString();
+        info.value = entry->m_Variable->ValueAsString();
+        info.default_value = entry->m_Variable->DefaultValueAsString();
+        if (const auto desc = entry->m_Variable->Description())
             info.description = std::string(*desc);
 
         return info;
     }
 
-    // serialization
-
-    std::expected<void, std::string> SaveToFile(const std::string &filepath) {
-        std::lock_guard lock(m_Mutex);
-
-        try {
-            json root = json::object();
+    // calls visitor(const SVariableInfoView &) for every variable, grouped by prefix like a saved file
+    // values are taken together under one lock and the visitor runs after releasing it, nothing is formatted
+    template<typename F>
+    void ForEachInfo(F &&visitor) const {
+        std::vector<SVariableInfoView> infos;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            infos.reserve(m_Variables.Size());
+            m_Paths.ForEach([&infos](const CVariableTable::SEntry &entry) {
+                const IConfigVariableBase &var = *entry.m_Variable;
+                infos.push_back({entry.m_Name, var.TypeString(), var.Description(), var.ReadOnly(),
+                                 CValueView::Current(var), CValueView::Default(var)});
+            });
+        }
 
-            for (const auto &[name, var]: m_Variables) {
-                SetNestedValue(root, name, var->ValueAsJson());
-            }
+        for (const auto &info: infos)
+            visitor(info);
+    }
 
-            std::ofstream file(filepath);
-            if (!file.is_open())
-                return std::unexpected("Failed to open file for writing: " + filepath);
+    // serialization
 
-            file << root.dump(4);
-            file.close();
+    // values are copied under the writer lock, formatting and disk I/O happen after releasing it
+    // indent follows json::dump(), pass -1 for compact output
+    std::expected<void, std::string> SaveToFile(const std::string &filepath, int indent = 4) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SAVE);
+        try {
+            return WriteSnapshot(filepath, ValueSnapshot(), indent);
+        } catch (const std::exception &e) {
+            return std::unexpected("Error saving config: " + std::string(e.what()));
+        }
+    }
 
+    // SaveToFile into memory, replaces the contents of out
+    std::expected<void, std::string> SaveToBuffer(std::string &out, int indent = 4) const {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SAVE);
+        try {
+            const Snapshot snapshot = ValueSnapshot();
+            out.clear();
+            CStringSink sink(out);
+            WriteSnapshotTo(sink, snapshot, indent);
+            m_Metrics.BytesWritten(out.size());
             return {};
         } catch (const std::exception &e) {
             return std::unexpected("Error saving config: " + std::string(e.what()));
         }
     }
 
+    // SaveToFile through an output iterator, returns the iterator past the last character written
+    template<typename OutputIt>
+    requires std::output_iterator<OutputIt, char>
+    std::expected<OutputIt, std::string> SaveToBuffer(OutputIt out, int indent = 4) const {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SAVE);
+        try {
+            const Snapshot snapshot = ValueSnapshot();
+            CIteratorSink sink(std::move(out));
+            WriteSnapshotTo(sink, snapshot, indent);
+            return sink.It();
+        } catch (const std::exception &e) {
+            return std::unexpected("Error saving config: " + std::string(e.what()));
+        }
+    }
+
     std::expected<void, std::string> Save() {
         if (m_ConfigPath.empty())
             return std::unexpected("No config path set. Use SetConfigPath() first.");
@@ -236,88 +910,449 @@ public:
     }
 
     std::expected<void, std::string> LoadFromFile(const std::string &filepath) {
-        std::lock_guard lock(m_Mutex);
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        auto root = ReadJsonFile(filepath);
+        if (!root.has_value())
+            return std::unexpected(root.error());
 
-        if (!std::filesystem::exists(filepath)) {
-            return std::unexpected("File doesn't exist");
-        }
+        return LoadDocument(*root);
+    }
 
-        try {
-            std::ifstream file(filepath);
-            if (!file.is_open())
-                return std::unexpected("Failed to open file for reading: " + filepath);
+    // LoadFromFile from memory, buffer is parsed in place and may point into a mapped file or an embedded string
+    std::expected<void, std::string> LoadFromBuffer(std::span<const char> buffer) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        auto root = ParseBuffer(buffer);
+        if (!root.has_value())
+            return std::unexpected(root.error());
 
-            json root;
-            file >> root;
-            file.close();
+        return LoadDocument(*root);
+    }
 
-            std::vector<std::string> errors;
+    // like LoadFromFile, but values are only converted and validated when they are first read
+    // subscribers hear about every variable present in the file, ValidateAll() reports the errors up front
+    std::expected<void, std::string> LoadFromFileLazy(const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        auto root = ReadJsonFile(filepath);
+        if (!root.has_value())
+            return std::unexpected(root.error());
+
+        std::vector<std::string> changed;
+
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            m_Paths.Match(*root, [&](const CVariableTable::SEntry &entry, json &value) {
+                entry.m_Variable->Defer(std::move(value));
+                m_Deferred.push_back(&entry);
+                changed.push_back(entry.m_Name);
+            });
+
+            std::ranges::sort(m_Deferred);
+            const auto [first, last] = std::ranges::unique(m_Deferred);
+            m_Deferred.erase(first, last);
+
+            m_LastApplied.reset();
+            Commit(changed);
+        }
 
-            for (const auto &[name, var]: m_Variables) {
-                auto value = GetNestedValue(root, name);
-                if (!value.has_value())
-                    continue;
+        Notify(changed);
+        return {};
+    }
 
-                auto result = var->TrySetJson(*value, true);
-                if (!result.has_value()) {
-                    errors.push_back(name + ": " + result.error());
-                }
-            }
+    // converts everything a lazy load left pending, for deployments that want to fail at startup
+    std::expected<void, std::string> ValidateAll() {
+        std::vector<std::string> errors;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            std::erase_if(m_Deferred, [&errors, this](const CVariableTable::SEntry *entry) {
+                auto result = entry->m_Variable->Resolve();
+                if (result.has_value())
+                    return true;
+                errors.push_back(entry->m_Name + ": " + result.error());
+                m_Metrics.ValidationFailed(entry->m_Name);
+                return false;
+            });
+        }
 
-            if (!errors.empty()) {
-                std::string errorMsg = "Some variables failed to load:\n";
-                for (const auto &err: errors)
-                    errorMsg += " - " + err + "\n";
-                return std::unexpected(errorMsg);
+        return JoinErrors(errors);
+    }
+
+    // same result as LoadFromFile without building a document, see CSaxBinder
+    // the writer lock is held while parsing, readers are not affected
+    std::expected<void, std::string> LoadFromFileStreaming(const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        CMappedFile file;
+        if (auto opened = file.Open(filepath); !opened.has_value())
+            return opened;
+
+        std::vector<std::string> errors;
+        std::vector<std::string> changed;
+
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+
+            // values are only applied once the whole file parsed, like with LoadFromFile
+            std::vector<std::pair<const CVariableTable::SEntry *, json> > values;
+            auto collect = [&values](const CVariableTable::SEntry &entry, json value) {
+                values.emplace_back(&entry, std::move(value));
+            };
+
+            try {
+                CSaxBinder<decltype(collect)> binder(m_Paths, collect);
+                [[maybe_unused]] const auto parseTimer = m_Metrics.Time(CConfigMetrics::OP_PARSE);
+                const auto data = file.Data();
+                if (!json::sax_parse(data.begin(), data.end(), &binder))
+                    return std::unexpected("JSON parse error: " + binder.Error());
+                m_Metrics.BytesRead(data.size());
+            } catch (const std::exception &e) {
+                return std::unexpected("Error loading config: " + std::string(e.what()));
             }
 
-            return {};
-        } catch (const json::exception &e) {
-            return std::unexpected("JSON parse error: " + std::string(e.what()));
-        } catch (const std::exception &e) {
-            return std::unexpected("Error loading config: " + std::string(e.what()));
+            std::vector<Assignment> assignments;
+            assignments.reserve(values.size());
+            for (const auto &[entry, value]: values)
+                assignments.emplace_back(entry, &value);
+            ApplyAll(assignments, errors, changed);
+
+            m_LastApplied.reset();
+            Commit(changed);
         }
+
+        Notify(changed);
+        return JoinErrors(errors);
     }
 
+    // like LoadFromFile, but only touches variables whose value in the file changed since the last reload
+    // values changed through Set() in between are kept until the file changes them
+    std::expected<void, std::string> ReloadFromFile(const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        auto root = ReadJsonFile(filepath);
+        if (!root.has_value())
+            return std::unexpected(root.error());
+
+        return ReloadDocument(std::move(*root));
+    }
+
+    // async loads from memory, for configs fetched over the network
+    // the caller only queues the work: parsing happens with no lock held and the values are stored in one batch
+    // a load finishing after a newer one was stored fails with "Superseded by a newer load" instead of rolling it back
+    // the registry has to outlive the loads it started
+
+    // runs the async loads, a detached thread per load if unset
+    void SetLoadExecutor(Executor executor) {
+        std::lock_guard lock(m_SubscriptionMutex);
+        m_LoadExecutor = std::move(executor);
+    }
+
+    // like LoadFromFile
+    CAsyncLoad LoadFromBufferAsync(std::string buffer) { return RunAsync(std::move(buffer), false); }
+
+    // like ReloadFromFile, only variables whose value changed since the last reload are touched
+    CAsyncLoad ReloadFromBufferAsync(std::string buffer) { return RunAsync(std::move(buffer), true); }
+
     std::expected<void, std::string> Load() {
         if (m_ConfigPath.empty())
             return std::unexpected("No config path set. Use SetConfigPath() first.");
         return LoadFromFile(m_ConfigPath);
     }
 
-    // config with metadata (descriptions, types, defaults)
-    std::expected<void, std::string> ExportTemplate(const std::string &filepath) {
-        std::lock_guard lock(m_Mutex);
+    // binary snapshot, see binary.h
+    // meant as a cache of the json config, loading fails if the registered variables changed since it was written
+
+    std::expected<void, std::string> SaveBinary(const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_SAVE);
+        std::string contents;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            CBinaryBuilder builder;
+            builder.Reserve(m_Variables.Size());
+            m_Paths.ForEach([&builder](const CVariableTable::SEntry &entry) { builder.Add(entry); });
+            contents = builder.Finish();
+        }
 
-        try {
-            json root = json::object();
-
-            for (const auto &[name, var]: m_Variables) {
-                json varInfo = json::object();
-                varInfo["readonly"] = var->ReadOnly();
-                varInfo["value"] = var->ValueAsJson();
-                varInfo["default"] = var->DefaultValueAsJson();
-                varInfo["type"] = var->TypeString();
-                if (auto desc = var->Description())
-                    varInfo["description"] = std::string(*desc);
-
-                SetNestedValue(root, name, varInfo);
+        CAtomicFile file(filepath);
+        file.Write(contents);
+        m_Metrics.BytesWritten(file.Written());
+        return file.Commit();
+    }
+
+    // values are decoded straight from the mapped file, no document is built
+    std::expected<void, std::string> LoadBinary(const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        CMappedFile file;
+        if (auto opened = file.Open(filepath); !opened.has_value())
+            return opened;
+
+        m_Metrics.BytesRead(file.Data().size());
+        auto snapshot = CBinarySnapshot::Open(file.Data());
+        if (!snapshot.has_value())
+            return std::unexpected(snapshot.error());
+
+        std::vector<std::string> errors;
+        std::vector<std::string> changed;
+
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            if (snapshot->SchemaHash() != SchemaHash())
+                return std::unexpected("Binary snapshot was written for a different set of variables");
+
+            PublishBatch([&] {
+                for (size_t i = 0; i < snapshot->Size(); ++i) {
+                    const auto value = snapshot->Value(i);
+                    if (!value.has_value()) {
+                        errors.push_back(value.error());
+                        continue;
+                    }
+
+                    const auto *entry = m_Variables.Find(value->m_Name);
+                    if (!entry)
+                        continue;
+
+                    const uint64_t revision = entry->m_Variable->Revision();
+                    if (auto result = ApplyBinaryValue(*entry->m_Variable, *value); !result.has_value()) {
+                        errors.push_back(entry->m_Name + ": " + result.error());
+                        m_Metrics.ValidationFailed(entry->m_Name);
+                    }
+                    if (entry->m_Variable->Revision() != revision)
+                        changed.push_back(entry->m_Name);
+                }
+            });
+
+            m_LastApplied.reset();
+            Commit(changed);
+        }
+
+        Notify(changed);
+        return JoinErrors(errors);
+    }
+
+    // layers
+    // every layer is a set of name/value texts with a unique priority, the highest priority layer holding
+    // a variable decides its value and variables no layer holds keep their default
+    // a change to a layer restages only the names it touched, all of them or none, reads stay one lookup
+    // the first SetLayer or LoadLayerFrom* of a layer may set read-only variables, later changes that would
+    // move one fail like Set() on it does
+    // Set() and the Load functions still write variables directly, until a layer touching them changes
+
+    bool AddLayer(std::string layer, int priority) {
+        CMeasuredLock lock(m_Mutex, m_Metrics);
+        return m_Layers.Add(std::move(layer), priority);
+    }
+
+    // replaces all values of a layer
+    std::expected<void, std::string> SetLayer(std::string_view layer, CConfigLayers::Values values) {
+        std::vector<std::string> changed;
+        std::expected<void, std::string> result;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            result = ReplaceLayer(layer, std::move(values), changed);
+        }
+
+        Notify(changed);
+        return result;
+    }
+
+    // sets one value of a layer, nullopt removes it so lower layers show through again
+    std::expected<void, std::string> SetLayerValue(std::string_view layer, std::string_view name,
+                                                   std::optional<std::string_view> value) {
+        std::vector<std::string> changed;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            if (!m_Layers.Contains(layer))
+                return std::unexpected("Layer '" + std::string(layer) + "' not found");
+
+            const std::vector<std::string> names = {std::string(name)};
+            const LayerWinners before = ReadOnlyWinners(names);
+            auto previous = m_Layers.Assign(layer, name, value ? std::optional<std::string>(*value) : std::nullopt);
+            if (auto result = ApplyLayers(names, changed, &before); !result.has_value()) {
+                m_Layers.Assign(layer, name, std::move(previous));
+                return result;
             }
+            m_Layers.MarkFilled(layer);
+            Commit(changed);
+        }
 
-            std::ofstream file(filepath);
-            if (!file.is_open())
-                return std::unexpected("Failed to open file for writing: " + filepath);
+        Notify(changed);
+        return {};
+    }
 
-            file << root.dump(4);
-            file.close();
+    // variables the layer held fall back to the layers below it
+    std::expected<void, std::string> RemoveLayer(std::string_view layer) {
+        std::vector<std::string> changed;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            const auto priority = m_Layers.Priority(layer);
+            if (!priority)
+                return std::unexpected("Layer '" + std::string(layer) + "' not found");
+
+            const std::vector<std::string> names = CConfigLayers::Keys(*m_Layers.Find(layer));
+            const LayerWinners before = ReadOnlyWinners(names);
+            auto values = *m_Layers.Remove(layer);
+            if (auto result = ApplyLayers(names, changed, &before); !result.has_value()) {
+                m_Layers.Add(std::string(layer), *priority);
+                m_Layers.Replace(layer, std::move(values));
+                return result;
+            }
+            Commit(changed);
+        }
 
-            return {};
+        Notify(changed);
+        return {};
+    }
+
+    // fills a layer from a json config file, only variables registered when it is loaded are taken
+    std::expected<void, std::string> LoadLayerFromFile(std::string_view layer, const std::string &filepath) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_LOAD);
+        auto root = ReadJsonFile(filepath);
+        if (!root.has_value())
+            return std::unexpected(root.error());
+
+        std::vector<std::string> changed;
+        std::expected<void, std::string> result;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            CConfigLayers::Values values;
+            m_Paths.Match(*root, [&values](const CVariableTable::SEntry &entry, const json &value) {
+                values.emplace(entry.m_Name, value.is_string() ? value.get<std::string>() : value.dump());
+            });
+            result = ReplaceLayer(layer, std::move(values), changed);
+        }
+
+        Notify(changed);
+        return result;
+    }
+
+    // fills a layer from environment variables, "net.http.port" is read from prefix + "NET_HTTP_PORT"
+    std::expected<void, std::string> LoadLayerFromEnvironment(std::string_view layer, std::string_view prefix) {
+        std::vector<std::string> changed;
+        std::expected<void, std::string> result;
+        {
+            CMeasuredLock lock(m_Mutex, m_Metrics);
+            CConfigLayers::Values values;
+            m_Paths.ForEach([&values, prefix](const CVariableTable::SEntry &entry) {
+                if (const char *pValue = std::getenv(CConfigLayers::EnvironmentName(prefix, entry.m_Name).c_str()))
+                    values.emplace(entry.m_Name, pValue);
+            });
+            result = ReplaceLayer(layer, std::move(values), changed);
+        }
+
+        Notify(changed);
+        return result;
+    }
+
+    // fills a layer from "--name=value" arguments, anything else on the command line is ignored
+    std::expected<void, std::string> LoadLayerFromArguments(std::string_view layer, int argc, const char *const *argv) {
+        return SetLayer(layer, CConfigLayers::FromArguments(argc, argv));
+    }
+
+    // config with metadata (descriptions, types, defaults)
+    std::expected<void, std::string> ExportTemplate(const std::string &filepath, int indent = 4) {
+        [[maybe_unused]] const auto timer = m_Metrics.Time(CConfigMetrics::OP_EXPORT);
+        try {
+            Snapshot snapshot;
+            {
+                CMeasuredLock lock(m_Mutex, m_Metrics);
+                snapshot = TakeSnapshot([](const IConfigVariableBase &var) {
+                    json varInfo = json::object();
+                    varInfo["readonly"] = var.ReadOnly();
+                    varInfo["value"] = var.ValueAsJson();
+                    varInfo["default"] = var.DefaultValueAsJson();
+                    varInfo["type"] = var.TypeString();
+                    if (auto desc = var.Description())
+                        varInfo["description"] = std::string(*desc);
+                    return varInfo;
+                });
+            }
+
+            return WriteSnapshot(filepath, snapshot, indent);
         } catch (const std::exception &e) {
             return std::unexpected("Error exporting template: " + std::string(e.what()));
         }
     }
 };
 
+// values collected for one SetMany call, owns the strings so callers can build it up from temporaries
+class CConfigTransaction {
+    CConfigRegistry &m_Registry;
+    std::vector<std::pair<std::string, std::string> > m_Values;
+
+public:
+    explicit CConfigTransaction(CConfigRegistry &registry) : m_Registry(registry) {
+    }
+
+    CConfigTransaction &Set(std::string_view name, std::string_view value) {
+        m_Values.emplace_back(name, value);
+        return *this;
+    }
+
+    std::expected<void, std::string> Commit() {
+        std::vector<std::pair<std::string_view, std::string_view> > values(m_Values.begin(), m_Values.end());
+        return m_Registry.SetMany(values);
+    }
+};
+
+inline CConfigTransaction CConfigRegistry::Transaction() { return CConfigTransaction(*this); }
+
+// variables below a prefix addressed by their relative names, Scope("net.http").Get<int>("port")
+// lookups continue the hash of the prefix and never build the full name, they are as lock-free as CConfigRegistry::Get
+class CConfigScope {
+    CConfigRegistry &m_Registry;
+    // always empty or ending in '.'
+    std::string m_Prefix;
+    uint64_t m_PrefixHash;
+
+    const CVariableTable::SEntry *Find(std::string_view name) const {
+        return m_Registry.m_Variables.Find(HashName(name, m_PrefixHash), m_Prefix, name);
+    }
+
+public:
+    CConfigScope(CConfigRegistry &registry, std::string_view prefix) : m_Registry(registry), m_Prefix(prefix) {
+        if (!m_Prefix.empty() && !m_Prefix.ends_with('.'))
+            m_Prefix += '.';
+        m_PrefixHash = HashName(m_Prefix);
+    }
+
+    std::string_view Prefix() const { return m_Prefix; }
+
+    CConfigScope Scope(std::string_view name) const { return CConfigScope(m_Registry, m_Prefix + std::string(name)); }
+
+    bool Exists(std::string_view name) const { return Find(name) != nullptr; }
+
+    template<typename T>
+    std::optional<T> Get(std::string_view name) const {
+        auto *wrapper = CConfigRegistry::As<T>(Find(name));
+        if (!wrapper)
+            return std::nullopt;
+
+        return wrapper->Value();
+    }
+
+    template<typename T>
+    CConfigHandle<T> Handle(std::string_view name) const {
+        auto *wrapper = CConfigRegistry::As<T>(Find(name));
+        if (!wrapper)
+            return {};
+
+        return CConfigHandle<T>(*wrapper, &m_Registry.m_Generation);
+    }
+
+    std::optional<std::string> GetAsString(std::string_view name) const {
+        const auto *entry = Find(name);
+        if (!entry)
+            return std::nullopt;
+        return entry->m_Variable->ValueAsString();
+    }
+
+    // writes go through the registry under the full name, they take its lock anyway
+    std::expected<void, std::string> Set(std::string_view name, std::string_view value) {
+        return m_Registry.Set(m_Prefix + std::string(name), value);
+    }
+
+    // full names of the variables in this scope
+    std::vector<std::string_view> List() const { return m_Registry.ListPrefix(m_Prefix); }
+};
+
+inline CConfigScope CConfigRegistry::Scope(std::string_view prefix) { return CConfigScope(*this, prefix); }
+
 inline CConfigRegistry &Config() { return CConfigRegistry::Instance(); }
 
 #define CONFIG_STRING(name, defaultValue, validators) CConfigRegistry::Instance().Register<std::string>(CConfigVariable<std::string>(name, defaultValue, validators))
@@ -0,0 +1,132 @@
+#ifndef CONFIG_SAX_LOADER_H
+#define CONFIG_SAX_LOADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+#include "path_index.h"
+
+using namespace nlohmann;
+
+// sax consumer that tracks the current dotted path through the path index
+// only values of registered variables are materialized, everything else is skipped while parsing
+template<typename F>
+class CSaxBinder {
+    // one per open object or array
+    struct SFrame {
+        const CPathIndex::SNode *m_pNode; // nullptr for skipped subtrees and arrays
+        // variable whose value this container is, handed the captured tree once it closes
+        const CVariableTable::SEntry *m_pEntry;
+        json *m_pCaptured;
+    };
+
+    F m_Func;
+    std::vector<SFrame> m_Frames;
+    const CPathIndex::SNode *m_pRoot;
+    const CPathIndex::SNode *m_pNext = nullptr;
+
+    // value of a variable that is an object or array itself, variables registered below it still get theirs
+    json m_Captured;
+    std::vector<json *> m_Capture;
+    std::string m_CaptureKey;
+
+    std::string m_Error;
+
+    bool Capturing() const { return !m_Capture.empty(); }
+
+    json *CaptureSlot() {
+        json *pTop = m_Capture.back();
+        if (pTop->is_array()) {
+            pTop->push_back(nullptr);
+            return &pTop->back();
+        }
+        return &(*pTop)[m_CaptureKey];
+    }
+
+    bool Value(json Value) {
+        const CVariableTable::SEntry *pEntry = m_pNext ? m_pNext->m_pEntry : nullptr;
+        m_pNext = nullptr;
+        if (Capturing()) {
+            if (pEntry)
+                m_Func(*pEntry, Value);
+            *CaptureSlot() = std::move(Value);
+        } else if (pEntry) {
+            m_Func(*pEntry, std::move(Value));
+        }
+        return true;
+    }
+
+    bool Start(json Empty) {
+        const bool isObject = Empty.is_object();
+        SFrame frame{isObject && m_Frames.empty() ? m_pRoot : isObject ? m_pNext : nullptr, nullptr, nullptr};
+        if (m_pNext && m_pNext->m_pEntry)
+            frame.m_pEntry = m_pNext->m_pEntry;
+
+        if (Capturing()) {
+            json *pSlot = CaptureSlot();
+            *pSlot = std::move(Empty);
+            m_Capture.push_back(pSlot);
+        } else if (frame.m_pEntry) {
+            m_Captured = std::move(Empty);
+            m_Capture.push_back(&m_Captured);
+        }
+        if (frame.m_pEntry)
+            frame.m_pCaptured = m_Capture.back();
+
+        m_Frames.push_back(frame);
+        m_pNext = nullptr;
+        return true;
+    }
+
+    bool End() {
+        const SFrame frame = m_Frames.back();
+        m_Frames.pop_back();
+        if (Capturing())
+            m_Capture.pop_back();
+
+        if (frame.m_pEntry) {
+            if (Capturing())
+                m_Func(*frame.m_pEntry, *frame.m_pCaptured);
+            else
+                m_Func(*frame.m_pEntry, std::move(m_Captured));
+        }
+        return true;
+    }
+
+public:
+    CSaxBinder(const CPathIndex &Index, F Func) : m_Func(std::move(Func)), m_pRoot(&Index.Root()) {
+    }
+
+    bool null() { return Value(nullptr); }
+    bool boolean(bool Value) { return this->Value(Value); }
+    bool number_integer(json::number_integer_t Value) { return this->Value(Value); }
+    bool number_unsigned(json::number_unsigned_t Value) { return this->Value(Value); }
+    bool number_float(json::number_float_t Value, const json::string_t &) { return this->Value(Value); }
+    bool string(json::string_t &Value) { return this->Value(std::move(Value)); }
+    bool binary(json::binary_t &Value) { return this->Value(json::binary(std::move(Value))); }
+
+    bool start_object(std::size_t) { return Start(json::object()); }
+    bool end_object() { return End(); }
+    bool start_array(std::size_t) { return Start(json::array()); }
+    bool end_array() { return End(); }
+
+    bool key(json::string_t &Key) {
+        const CPathIndex::SNode *pNode = m_Frames.back().m_pNode;
+        m_pNext = pNode ? pNode->Child(Key) : nullptr;
+        if (Capturing())
+            m_CaptureKey = std::move(Key);
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const json::exception &Error) {
+        m_Error = Error.what();
+        return false;
+    }
+
+    const std::string &Error() const { return m_Error; }
+};
+
+#endif // CONFIG_SAX_LOADER_H
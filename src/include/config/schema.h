@@ -0,0 +1,305 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+#include "path_index.h"
+#include "table.h"
+#include "validator/stages.h"
+#include "variable.h"
+
+using namespace nlohmann;
+
+// string usable as a template argument
+template<size_t N>
+struct CFixedString {
+    char m_aData[N]{};
+
+    consteval CFixedString(const char (&Str)[N]) { std::copy_n(Str, N, m_aData); }
+
+    constexpr std::string_view View() const { return {m_aData, N - 1}; }
+};
+
+struct SNoRange {
+};
+
+// one setting declared at compile time: name, default and optional inclusive range
+// strings take their default as a CFixedString: SSetting<"net.host", CFixedString("localhost")>
+template<CFixedString Name, auto Default, auto Min = SNoRange{}, auto Max = SNoRange{}>
+struct SSetting {
+private:
+    template<typename D>
+    struct SValueType {
+        using Type = D;
+    };
+
+    template<size_t N>
+    struct SValueType<CFixedString<N> > {
+        using Type = std::string;
+    };
+
+public:
+    using Type = typename SValueType<std::remove_cv_t<decltype(Default)> >::Type;
+
+    static constexpr std::string_view s_Name = Name.View();
+    static constexpr bool s_Ranged = !std::is_same_v<std::remove_cv_t<decltype(Min)>, SNoRange>;
+
+    static_assert(s_Ranged == !std::is_same_v<std::remove_cv_t<decltype(Max)>, SNoRange>, "Both Min and Max are required for a range");
+
+    static Type DefaultValue() {
+        if constexpr (std::is_same_v<Type, std::string>)
+            return std::string(Default.View());
+        else
+            return Default;
+    }
+
+    static std::expected<Type, std::string> Check(Type value) {
+        if constexpr (s_Ranged)
+            return ValidatorStages::Range<Type>{Min, Max}(std::move(value));
+        else
+            return value;
+    }
+
+    static std::expected<Type, std::string> Parse(std::string_view text) {
+        text = *ValidatorStages::Trim()(text);
+        std::expected<Type, std::string> parsed;
+        if constexpr (std::is_same_v<Type, std::string>) {
+            parsed = std::string(text);
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            parsed = ValidatorStages::Boolean<bool>()(text);
+        } else if constexpr (std::is_floating_point_v<Type>) {
+            parsed = ValidatorStages::ParseFloat<Type>(text);
+        } else {
+            parsed = ValidatorStages::ParseInteger<Type>(text);
+        }
+
+        if (!parsed.has_value())
+            return parsed;
+        return Check(std::move(parsed.value()));
+    }
+};
+
+// hash and displace perfect hash over a fixed set of names, built by the compiler
+template<size_t N>
+class CPerfectHash {
+    static constexpr size_t s_Buckets = N > 0 ? N : 1;
+    static constexpr size_t s_Slots = std::bit_ceil(N * 2 > 0 ? N * 2 : 1);
+    static constexpr uint32_t s_Empty = UINT32_MAX;
+
+    std::array<uint32_t, s_Buckets> m_Displacement{};
+    std::array<uint32_t, s_Slots> m_Slots{};
+
+    static constexpr uint64_t Mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static constexpr size_t Bucket(uint64_t hash) { return (hash >> 32) % s_Buckets; }
+
+    static constexpr size_t Slot(uint64_t hash, uint32_t displacement) {
+        return Mix(hash ^ (displacement * 0x9e3779b97f4a7c15ull)) & (s_Slots - 1);
+    }
+
+public:
+    consteval explicit CPerfectHash(const std::array<std::string_view, N> &Names) {
+        std::array<uint64_t, N> hashes{};
+        std::array<uint32_t, N> order{};
+        std::array<uint32_t, s_Buckets> sizes{};
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = HashName(Names[i]);
+            order[i] = i;
+            ++sizes[Bucket(hashes[i])];
+        }
+        m_Slots.fill(s_Empty);
+
+        // biggest buckets first, keys of a bucket end up next to each other
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const size_t bucketA = Bucket(hashes[a]), bucketB = Bucket(hashes[b]);
+            if (sizes[bucketA] != sizes[bucketB])
+                return sizes[bucketA] > sizes[bucketB];
+            return bucketA < bucketB;
+        });
+
+        for (size_t first = 0; first < N;) {
+            const size_t bucket = Bucket(hashes[order[first]]);
+            const size_t last = first + sizes[bucket];
+
+            for (uint32_t displacement = 0;; ++displacement) {
+                bool fits = true;
+                for (size_t i = first; i < last && fits; ++i) {
+                    const size_t slot = Slot(hashes[order[i]], displacement);
+                    fits = m_Slots[slot] == s_Empty;
+                    for (size_t j = first; j < i && fits; ++j)
+                        fits = Slot(hashes[order[j]], displacement) != slot;
+                }
+                if (!fits)
+                    continue;
+
+                m_Displacement[bucket] = displacement;
+                for (size_t i = first; i < last; ++i)
+                    m_Slots[Slot(hashes[order[i]], displacement)] = order[i];
+                break;
+            }
+            first = last;
+        }
+    }
+
+    // index of the name if it is one of the set, the caller compares the names
+    constexpr std::optional<size_t> Candidate(uint64_t Hash) const {
+        const uint32_t index = m_Slots[Slot(Hash, m_Displacement[Bucket(Hash)])];
+        if (index == s_Empty)
+            return std::nullopt;
+        return index;
+    }
+};
+
+// typed settings struct generated from the declarations, no registration pass and no runtime index
+// Get<"net.port">() resolves to a member at compile time, name based access goes through a perfect hash
+template<typename... Settings>
+class CConfigSchema {
+    static constexpr size_t s_Count = sizeof...(Settings);
+    static constexpr std::array<std::string_view, s_Count> s_Names = {Settings::s_Name...};
+    static constexpr CPerfectHash<s_Count> s_Index{s_Names};
+
+    static_assert([] {
+        for (size_t i = 0; i < s_Count; ++i)
+            for (size_t j = i + 1; j < s_Count; ++j)
+                if (s_Names[i] == s_Names[j])
+                    return false;
+        return true;
+    }(), "Setting names must be unique");
+
+    std::tuple<CValueCell<typename Settings::Type>...> m_Values;
+
+    template<CFixedString Name>
+    static consteval size_t IndexOf() {
+        for (size_t i = 0; i < s_Count; ++i)
+            if (s_Names[i] == Name.View())
+                return i;
+        throw "Unknown setting";
+    }
+
+    template<size_t I>
+    using SettingAt = std::tuple_element_t<I, std::tuple<Settings...> >;
+
+    template<typename F>
+    static void ForEachIndex(F &&Func) {
+        [&]<size_t... I>(std::index_sequence<I...>) { (Func(std::integral_constant<size_t, I>()), ...); }(
+            std::make_index_sequence<s_Count>());
+    }
+
+    template<size_t I>
+    std::expected<void, std::string> SetAt(std::string_view Value) {
+        auto parsed = SettingAt<I>::Parse(Value);
+        if (!parsed.has_value())
+            return std::unexpected(parsed.error());
+        std::get<I>(m_Values).Store(std::move(parsed.value()));
+        return {};
+    }
+
+public:
+    CConfigSchema() : m_Values(Settings::DefaultValue()...) {
+    }
+
+    static constexpr size_t Size() { return s_Count; }
+
+    static constexpr std::optional<size_t> Find(std::string_view Name) {
+        const auto index = s_Index.Candidate(HashName(Name));
+        if (!index.has_value() || s_Names[*index] != Name)
+            return std::nullopt;
+        return index;
+    }
+
+    template<CFixedString Name>
+    auto Get() const {
+        return std::get<IndexOf<Name>()>(m_Values).Load();
+    }
+
+    template<CFixedString Name>
+    const auto &Cell() const {
+        return std::get<IndexOf<Name>()>(m_Values);
+    }
+
+    template<CFixedString Name>
+    std::expected<void, std::string> Set(typename SettingAt<IndexOf<Name>()>::Type Value) {
+        auto checked = SettingAt<IndexOf<Name>()>::Check(std::move(Value));
+        if (!checked.has_value())
+            return std::unexpected(checked.error());
+        std::get<IndexOf<Name>()>(m_Values).Store(std::move(checked.value()));
+        return {};
+    }
+
+    // name based access for admin and file input, writers have to be serialized by the caller
+
+    std::expected<void, std::string> Set(std::string_view Name, std::string_view Value) {
+        const auto index = Find(Name);
+        if (!index.has_value())
+            return std::unexpected("Variable '" + std::string(Name) + "' not found");
+
+        using Setter = std::expected<void, std::string> (CConfigSchema::*)(std::string_view);
+        static constexpr auto s_Setters = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<Setter, s_Count>{&CConfigSchema::SetAt<I>...};
+        }(std::make_index_sequence<s_Count>());
+
+        return (this->*s_Setters[*index])(Value);
+    }
+
+    std::expected<void, std::string> ApplyJson(const json &Root) {
+        std::vector<std::string> errors;
+        ForEachIndex([&](auto I) {
+            using Setting = SettingAt<I()>;
+            const json *value = CPathIndex::Lookup(Root, Setting::s_Name);
+            if (!value)
+                return;
+
+            try {
+                auto checked = Setting::Check(value->template get<typename Setting::Type>());
+                if (checked.has_value())
+                    std::get<I()>(m_Values).Store(std::move(checked.value()));
+                else
+                    errors.push_back(std::string(Setting::s_Name) + ": " + checked.error());
+            } catch (const json::exception &e) {
+                errors.push_back(std::string(Setting::s_Name) + ": JSON parse error: " + e.what());
+            }
+        });
+
+        if (errors.empty())
+            return {};
+
+        std::string errorMsg = "Some variables failed to load:\n";
+        for (const auto &err: errors)
+            errorMsg += " - " + err + "\n";
+        return std::unexpected(errorMsg);
+    }
+
+    json ToJson() const {
+        json root = json::object();
+        ForEachIndex([&](auto I) {
+            json *current = &root;
+            std::string_view name = SettingAt<I()>::s_Name;
+            for (size_t dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.')) {
+                current = &(*current)[std::string(name.substr(0, dot))];
+                name.remove_prefix(dot + 1);
+            }
+            (*current)[std::string(name)] = std::get<I()>(m_Values).Load();
+        });
+        return root;
+    }
+};
+
+#endif // CONFIG_SCHEMA_H
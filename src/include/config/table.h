@@ -0,0 +1,154 @@
+#ifndef CONFIG_TABLE_H
+#define CONFIG_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "variable.h"
+
+inline constexpr uint64_t s_NameHashBasis = 14695981039346656037ull;
+
+// FNV-1a, constexpr so names known at compile time can be hashed by the compiler
+// hashing continues from Hash, HashName(b, HashName(a)) equals HashName(a + b)
+constexpr uint64_t HashName(std::string_view Name, uint64_t Hash = s_NameHashBasis) {
+    uint64_t hash = Hash;
+    for (const char c: Name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// variable name paired with its hash, lookups through it never allocate
+// "net.http.port"_cfg hashes at compile time
+class CConfigKey {
+    std::string_view m_Name;
+    uint64_t m_Hash;
+
+public:
+    constexpr CConfigKey(std::string_view Name) : m_Name(Name), m_Hash(HashName(Name)) {
+    }
+
+    constexpr CConfigKey(const char *Name) : CConfigKey(std::string_view(Name)) {
+    }
+
+    CConfigKey(const std::string &Name) : CConfigKey(std::string_view(Name)) {
+    }
+
+    constexpr std::string_view Name() const { return m_Name; }
+    constexpr uint64_t Hash() const { return m_Hash; }
+};
+
+consteval CConfigKey operator""_cfg(const char *Name, size_t Size) {
+    return CConfigKey(std::string_view(Name, Size));
+}
+
+// append-only open addressing table of variables
+// lookups and iteration are lock-free, inserts must be serialized by the owner
+class CVariableTable {
+public:
+    struct SEntry {
+        std::string m_Name;
+        uint64_t m_Hash;
+        std::unique_ptr<IConfigVariableBase> m_Variable;
+    };
+
+private:
+    struct SSlots {
+        size_t m_Mask;
+        std::unique_ptr<std::atomic<SEntry *>[]> m_Slots;
+
+        explicit SSlots(size_t Capacity) : m_Mask(Capacity - 1), m_Slots(new std::atomic<SEntry *>[Capacity]) {
+            for (size_t i = 0; i < Capacity; ++i)
+                m_Slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        size_t Capacity() const { return m_Mask + 1; }
+
+        void Place(SEntry *pEntry) {
+            size_t i = pEntry->m_Hash & m_Mask;
+            while (m_Slots[i].load(std::memory_order_relaxed))
+                i = (i + 1) & m_Mask;
+            m_Slots[i].store(pEntry, std::memory_order_release);
+        }
+    };
+
+    std::atomic<SSlots *> m_Current;
+    std::atomic<size_t> m_Size = 0;
+    std::vector<std::unique_ptr<SEntry> > m_Entries;
+    // slot arrays replaced by a grow, readers may still be probing them so they live as long as the table
+    std::vector<std::unique_ptr<SSlots> > m_Generations;
+
+public:
+    CVariableTable() {
+        m_Generations.push_back(std::make_unique<SSlots>(64));
+        m_Current.store(m_Generations.back().get(), std::memory_order_release);
+    }
+
+    CVariableTable(const CVariableTable &) = delete;
+    CVariableTable &operator=(const CVariableTable &) = delete;
+
+    SEntry *Find(const CConfigKey &Key) const {
+        return Find(Key.Hash(), {}, Key.Name());
+    }
+
+    // finds Prefix + Name without concatenating them, Hash is the hash of the whole name
+    SEntry *Find(uint64_t Hash, std::string_view Prefix, std::string_view Name) const {
+        const SSlots *pSlots = m_Current.load(std::memory_order_acquire);
+
+        for (size_t i = Hash & pSlots->m_Mask;; i = (i + 1) & pSlots->m_Mask) {
+            SEntry *pEntry = pSlots->m_Slots[i].load(std::memory_order_acquire);
+            if (!pEntry)
+                return nullptr;
+            const std::string_view name = pEntry->m_Name;
+            if (pEntry->m_Hash == Hash && name.size() == Prefix.size() + Name.size() && name.starts_with(Prefix) &&
+                name.ends_with(Name))
+                return pEntry;
+        }
+    }
+
+    bool Contains(const CConfigKey &Key) const { return Find(Key) != nullptr; }
+
+    size_t Size() const { return m_Size.load(std::memory_order_acquire); }
+
+    // caller must hold the writer lock and check for duplicates first
+    SEntry &Insert(std::string Name, std::unique_ptr<IConfigVariableBase> Variable) {
+        auto entry = std::make_unique<SEntry>();
+        entry->m_Hash = HashName(Name);
+        entry->m_Name = std::move(Name);
+        entry->m_Variable = std::move(Variable);
+
+        SSlots *pSlots = m_Current.load(std::memory_order_relaxed);
+        if ((m_Entries.size() + 1) * 2 > pSlots->Capacity()) {
+            auto grown = std::make_unique<SSlots>(pSlots->Capacity() * 2);
+            for (const auto &existing: m_Entries)
+                grown->Place(existing.get());
+            pSlots = grown.get();
+            m_Generations.push_back(std::move(grown));
+            m_Current.store(pSlots, std::memory_order_release);
+        }
+
+        SEntry &result = *entry;
+        m_Entries.push_back(std::move(entry));
+        pSlots->Place(&result);
+        m_Size.store(m_Entries.size(), std::memory_order_release);
+        return result;
+    }
+
+    // visits every published entry without locking, entries inserted concurrently may or may not be seen
+    template<typename F>
+    void ForEach(F &&Func) const {
+        const SSlots *pSlots = m_Current.load(std::memory_order_acquire);
+        for (size_t i = 0; i < pSlots->Capacity(); ++i) {
+            if (const SEntry *pEntry = pSlots->m_Slots[i].load(std::memory_order_acquire))
+                Func(*pEntry);
+        }
+    }
+};
+
+#endif // CONFIG_TABLE_H
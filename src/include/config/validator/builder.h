@@ -1,136 +1,117 @@
 #ifndef CONFIG_BUILDER_H
 #define CONFIG_BUILDER_H
 
-#include "pipeline.h"
+#include <limits>
+#include <optional>
+#include <type_traits>
 
-#include <algorithm>
-#include <ranges>
+#include "pipeline.h"
+#include "stages.h"
 
 template<typename T>
 class ValidatorBuilder {
+    // numeric chains made only of Trim, NotEmpty, Integer/Float and Min/Max/Range also build a fused kernel
+    static constexpr bool s_Fusable = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
     ValidatorPipeline<T> m_Pipeline;
+    // dropped as soon as a stage the kernel doesn't cover is added
+    std::optional<ValidatorStages::NumericKernel<T> > m_Kernel;
+    bool m_Parsed = false;
+
+    const ValidatorStages::NumericKernel<T> *Kernel() const {
+        return m_Kernel.has_value() && m_Parsed ? &*m_Kernel : nullptr;
+    }
 
 public:
-    operator std::function<std::expected<T, std::string>(std::string)>() {
+    ValidatorBuilder() {
+        if constexpr (s_Fusable)
+            m_Kernel.emplace();
+    }
+
+    operator std::function<std::expected<T, std::string>(std::string_view)>() const {
+        if constexpr (s_Fusable) {
+            if (const auto *pKernel = Kernel())
+                return *pKernel;
+        }
         return m_Pipeline;
     }
 
+    std::expected<T, std::string> operator()(std::string_view value) const {
+        if constexpr (s_Fusable) {
+            if (const auto *pKernel = Kernel())
+                return (*pKernel)(value);
+        }
+        return m_Pipeline(value);
+    }
+
+    // see ValidatorPipeline::ValidateBatch, fused chains run the kernel's batch passes instead
+    bool ValidateBatch(std::span<const std::string_view> values, std::span<T> out, ValidationErrors &errors) const {
+        if constexpr (s_Fusable) {
+            if (const auto *pKernel = Kernel())
+                return pKernel->ValidateBatch(values, out, errors);
+        }
+        return m_Pipeline.ValidateBatch(values, out, errors);
+    }
+
     // String Validators
 
     ValidatorBuilder &Trim() {
-        m_Pipeline.AddStringValidator([](const std::string &value) -> std::expected<std::string, std::string> {
-            std::string copy = value;
-            auto not_space = [](const unsigned char c) { return !std::isspace(c); };
-            copy.erase(
-                std::ranges::find_if(copy | std::views::reverse, not_space).base(),
-                copy.end());
-            copy.erase(
-                copy.begin(),
-                std::ranges::find_if(copy, not_space));
-            return copy;
-        });
+        m_Pipeline.AddStringViewValidator(ValidatorStages::Trim());
+        // trimming after the emptiness check can empty the value again, the kernel only checks after trimming
+        if (m_Kernel.has_value() && m_Kernel->m_NotEmpty && !m_Kernel->m_Trim)
+            m_Kernel.reset();
+        if (m_Kernel.has_value())
+            m_Kernel->m_Trim = true;
         return *this;
     }
 
     ValidatorBuilder &NotEmpty() {
-        m_Pipeline.AddStringValidator([](std::string value) -> std::expected<std::string, std::string> {
-            if (value.empty())
-                return std::unexpected("Value should not be empty");
-            return value;
-        });
+        m_Pipeline.AddStringViewValidator(ValidatorStages::NotEmpty());
+        if (m_Kernel.has_value())
+            m_Kernel->m_NotEmpty = true;
         return *this;
     }
 
     // Parsers
 
     ValidatorBuilder &Integer() {
-        m_Pipeline.SetParser([](const std::string &value) -> std::expected<T, std::string> {
-            if (value.empty())
-                return std::unexpected("String should not be empty");
-
-            try {
-                if constexpr (std::is_same_v<T, int>) {
-                    return std::stoi(value);
-                } else if constexpr (std::is_same_v<T, long>) {
-                    return std::stol(value);
-                } else if constexpr (std::is_same_v<T, long long>) {
-                    return std::stoll(value);
-                }
-            } catch (...) {
-                return std::unexpected("Failed to parse integer");
-            }
-            return std::unexpected("Unsupported integer type");
-        });
+        m_Pipeline.SetParser(ValidatorStages::Integer<T>());
+        m_Parsed = true;
         return *this;
     }
 
     ValidatorBuilder &Float() {
-        m_Pipeline.SetParser([](const std::string &value) -> std::expected<T, std::string> {
-            if (value.empty())
-                return std::unexpected("String should not be empty");
-
-            try {
-                if constexpr (std::is_same_v<T, float>) {
-                    return std::stof(value);
-                } else if constexpr (std::is_same_v<T, double>) {
-                    return std::stod(value);
-                }
-            } catch (...) {
-                return std::unexpected("Failed to parse float");
-            }
-            return std::unexpected("Unsupported float type");
-        });
+        m_Pipeline.SetParser(ValidatorStages::Float<T>());
+        m_Parsed = true;
         return *this;
     }
 
-
     ValidatorBuilder &Boolean() {
-        m_Pipeline.SetParser([](const std::string &value) -> std::expected<T, std::string> {
-            if (value.empty())
-                return std::unexpected("String should not be empty");
-
-            try {
-                if (value == "1" || value == "true") {
-                    return true;
-                }
-                if (value == "0" || value == "false") {
-                    return false;
-                }
-            } catch (...) {
-                return std::unexpected("Failed to parse bool");
-            }
-            return std::unexpected("Unsupported bool value (1/true/0/false)");
-        });
+        m_Pipeline.SetParser(ValidatorStages::Boolean<T>());
+        m_Kernel.reset();
         return *this;
     }
 
     // Typed Validator
 
     ValidatorBuilder &Min(T minValue) {
-        m_Pipeline.AddTypedValidator([minValue](T value) -> std::expected<T, std::string> {
-            if (value < minValue)
-                return std::unexpected("Value should be >=" + std::to_string(minValue));
-            return value;
-        });
+        m_Pipeline.AddTypedValidator(ValidatorStages::Min<T>{minValue});
+        if (m_Kernel.has_value())
+            m_Kernel->AddBound(minValue, std::numeric_limits<T>::max(), ValidatorStages::Min<T>{minValue});
         return *this;
     }
 
     ValidatorBuilder &Max(T maxValue) {
-        m_Pipeline.AddTypedValidator([maxValue](T value) -> std::expected<T, std::string> {
-            if (value > maxValue)
-                return std::unexpected("Value should be <=" + std::to_string(maxValue));
-            return value;
-        });
+        m_Pipeline.AddTypedValidator(ValidatorStages::Max<T>{maxValue});
+        if (m_Kernel.has_value())
+            m_Kernel->AddBound(std::numeric_limits<T>::lowest(), maxValue, ValidatorStages::Max<T>{maxValue});
         return *this;
     }
 
     ValidatorBuilder &Range(T minValue, T maxValue) {
-        m_Pipeline.AddTypedValidator([minValue, maxValue](T value) -> std::expected<T, std::string> {
-            if (value < minValue || value > maxValue)
-                return std::unexpected("Value should be >=" + std::to_string(minValue) +
-                                       " and <=" + std::to_string(maxValue));
-            return value;
-        });
+        m_Pipeline.AddTypedValidator(ValidatorStages::Range<T>{minValue, maxValue});
+        if (m_Kernel.has_value())
+            m_Kernel->AddBound(minValue, maxValue, ValidatorStages::Range<T>{minValue, maxValue});
         return *this;
     }
 
@@ -138,11 +119,19 @@ public:
 
     ValidatorBuilder &Custom(ValidatorPipeline<T>::StringValidator validator) {
         m_Pipeline.AddStringValidator(std::move(validator));
+        m_Kernel.reset();
+        return *this;
+    }
+
+    ValidatorBuilder &CustomView(ValidatorPipeline<T>::StringViewValidator validator) {
+        m_Pipeline.AddStringViewValidator(std::move(validator));
+        m_Kernel.reset();
         return *this;
     }
 
     ValidatorBuilder &CustomTyped(ValidatorPipeline<T>::TypedValidator validator) {
         m_Pipeline.AddTypedValidator(std::move(validator));
+        m_Kernel.reset();
         return *this;
     }
 };
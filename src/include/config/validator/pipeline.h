@@ -1,28 +1,59 @@
 #ifndef CONFIG_PIPELINE_H
 #define CONFIG_PIPELINE_H
 
+#include <algorithm>
+#include <cstddef>
 #include <expected>
 #include <functional>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// (index, message) for every value of a batch that failed, in index order
+using ValidationErrors = std::vector<std::pair<size_t, std::string> >;
 
 template<typename T>
 class ValidatorPipeline {
 public:
+    // narrows or checks the input without copying it
+    using StringViewValidator = std::function<std::expected<std::string_view, std::string>(std::string_view)>;
+    // produces a new string, only needed for stages that rewrite the input
     using StringValidator = std::function<std::expected<std::string, std::string>(std::string)>;
+    using Parser = std::function<std::expected<T, std::string>(std::string_view)>;
     using TypedValidator = std::function<std::expected<T, std::string>(T)>;
 
 private:
-    std::vector<StringValidator> m_StringValidators;
-    std::function<std::expected<T, std::string>(std::string)> m_Parser;
+    // rewriting stages keep their output in the buffer passed in and return a view of it
+    using Stage = std::function<std::expected<std::string_view, std::string>(std::string_view, std::string &)>;
+
+    std::vector<Stage> m_StringValidators;
+    Parser m_Parser;
     std::vector<TypedValidator> m_TypedValidators;
 
 public:
+    ValidatorPipeline &AddStringViewValidator(StringViewValidator validator) {
+        m_StringValidators.push_back(
+            [validator = std::move(validator)](std::string_view value, std::string &) { return validator(value); });
+        return *this;
+    }
+
     ValidatorPipeline &AddStringValidator(StringValidator validator) {
-        m_StringValidators.push_back(std::move(validator));
+        m_StringValidators.push_back(
+            [validator = std::move(validator)](std::string_view value, std::string &buffer)
+        -> std::expected<std::string_view, std::string> {
+                auto result = validator(std::string(value));
+                if (!result.has_value())
+                    return std::unexpected(result.error());
+                buffer = std::move(result.value());
+                return buffer;
+            });
         return *this;
     }
 
-    ValidatorPipeline &SetParser(std::function<std::expected<T, std::string>(std::string)> parser) {
+    ValidatorPipeline &SetParser(Parser parser) {
         m_Parser = std::move(parser);
         return *this;
     }
@@ -32,31 +63,98 @@ public:
         return *this;
     }
 
-    std::expected<T, std::string> operator()(std::string value) const {
+    std::expected<T, std::string> operator()(std::string_view value) const {
+        std::string buffer;
         for (const auto &validator: m_StringValidators) {
-            auto result = validator(value);
+            auto result = validator(value, buffer);
             if (!result.has_value())
                 return std::unexpected(result.error());
             value = result.value();
         }
 
-        if (!m_Parser)
+        std::expected<T, std::string> parsed;
+        if (m_Parser) {
+            parsed = m_Parser(value);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            // strings need no parser
+            parsed = std::string(value);
+        } else {
             return std::unexpected("No parser configured");
+        }
 
-        auto parsed = m_Parser(value);
         if (!parsed.has_value())
             return parsed;
 
-        T finalValue = parsed.value();
+        T finalValue = std::move(parsed.value());
         for (const auto &validator: m_TypedValidators) {
-            auto result = validator(finalValue);
+            auto result = validator(std::move(finalValue));
             if (!result.has_value())
                 return result;
-            finalValue = result.value();
+            finalValue = std::move(result.value());
         }
 
         return finalValue;
     }
+
+    // same results as calling the pipeline on every value, but each stage runs over the whole batch before
+    // the next one starts, a value leaves the batch at its first failing stage
+    // out[i] is only meaningful for indices without an error, returns true if no value failed
+    bool ValidateBatch(std::span<const std::string_view> values, std::span<T> out, ValidationErrors &errors) const {
+        const size_t count = std::min(values.size(), out.size());
+        std::vector<std::string_view> views(values.begin(), values.begin() + count);
+        std::vector<std::optional<std::string> > failures(count);
+        std::vector<std::string> buffers(m_StringValidators.empty() ? 0 : count);
+
+        for (const auto &validator: m_StringValidators) {
+            for (size_t i = 0; i < count; ++i) {
+                if (failures[i])
+                    continue;
+                auto result = validator(views[i], buffers[i]);
+                if (result.has_value())
+                    views[i] = result.value();
+                else
+                    failures[i] = std::move(result.error());
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (failures[i])
+                continue;
+
+            std::expected<T, std::string> parsed;
+            if (m_Parser) {
+                parsed = m_Parser(views[i]);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                parsed = std::string(views[i]);
+            } else {
+                parsed = std::unexpected("No parser configured");
+            }
+
+            if (parsed.has_value())
+                out[i] = std::move(parsed.value());
+            else
+                failures[i] = std::move(parsed.error());
+        }
+
+        for (const auto &validator: m_TypedValidators) {
+            for (size_t i = 0; i < count; ++i) {
+                if (failures[i])
+                    continue;
+                auto result = validator(std::move(out[i]));
+                if (result.has_value())
+                    out[i] = std::move(result.value());
+                else
+                    failures[i] = std::move(result.error());
+            }
+        }
+
+        const size_t before = errors.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (failures[i])
+                errors.emplace_back(i, std::move(*failures[i]));
+        }
+        return errors.size() == before;
+    }
 };
 
 #endif // CONFIG_PIPELINE_H
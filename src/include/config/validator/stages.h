@@ -0,0 +1,352 @@
+#ifndef CONFIG_STAGES_H
+#define CONFIG_STAGES_H
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <expected>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// validation stages shared by ValidatorBuilder and the statically composed StaticValidator
+// string stages narrow a view instead of copying, parsers and typed stages only format text on failure
+namespace ValidatorStages {
+    // String Validators
+
+    struct Trim {
+        std::expected<std::string_view, std::string> operator()(std::string_view value) const {
+            auto not_space = [](const unsigned char c) { return !std::isspace(c); };
+            const auto first = std::ranges::find_if(value, not_space);
+            const auto last = std::ranges::find_if(value.rbegin(), value.rend(), not_space).base();
+            if (first >= last)
+                return std::string_view();
+            return std::string_view(first, last);
+        }
+    };
+
+    struct NotEmpty {
+        std::expected<std::string_view, std::string> operator()(std::string_view value) const {
+            if (value.empty())
+                return std::unexpected("Value should not be empty");
+            return value;
+        }
+    };
+
+    // Parsers
+
+    namespace Detail {
+        // copies the digits without '_' separators into out, separators must sit between two digits
+        inline std::optional<std::string_view> StripSeparators(std::string_view value, std::span<char> out) {
+            if (value.find('_') == std::string_view::npos)
+                return value;
+            if (value.front() == '_' || value.back() == '_')
+                return std::nullopt;
+
+            size_t size = 0;
+            for (size_t i = 0; i < value.size(); ++i) {
+                if (value[i] == '_') {
+                    if (value[i + 1] == '_')
+                        return std::nullopt;
+                    continue;
+                }
+                if (size == out.size())
+                    return std::nullopt;
+                out[size++] = value[i];
+            }
+            return std::string_view(out.data(), size);
+        }
+
+        // plain decimal digits with an optional '-', short enough that T can't overflow
+        // everything else is left to ParseInteger, the loop has no early exit so batches keep it branch free
+        template<typename T>
+        bool ParseDigitRun(std::string_view value, T &out) {
+            using U = std::make_unsigned_t<T>;
+            const bool negative = !value.empty() && value.front() == '-';
+            if (negative) {
+                if constexpr (std::is_unsigned_v<T>)
+                    return false;
+                value.remove_prefix(1);
+            }
+            if (value.empty() || value.size() > static_cast<size_t>(std::numeric_limits<T>::digits10))
+                return false;
+
+            U magnitude = 0;
+            bool digits = true;
+            for (const char c: value) {
+                const unsigned digit = static_cast<unsigned char>(c) - unsigned('0');
+                digits &= digit < 10;
+                magnitude = static_cast<U>(magnitude * 10 + digit);
+            }
+            if (!digits)
+                return false;
+
+            out = negative ? static_cast<T>(U(0) - magnitude) : static_cast<T>(magnitude);
+            return true;
+        }
+
+        inline bool ConsumeHexPrefix(std::string_view &value) {
+            if (value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X')) {
+                value.remove_prefix(2);
+                return true;
+            }
+            return false;
+        }
+    }
+
+    // accepts an optional sign, 0x hex and '_' digit separators, the whole input has to be consumed
+    template<typename T>
+    std::expected<T, std::string> ParseInteger(std::string_view value) {
+        static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "Unsupported integer type");
+        using U = std::make_unsigned_t<T>;
+
+        if (value.empty())
+            return std::unexpected("String should not be empty");
+
+        const bool negative = value.front() == '-';
+        if (negative || value.front() == '+')
+            value.remove_prefix(1);
+        if (negative && std::is_unsigned_v<T>)
+            return std::unexpected("Value should not be negative");
+
+        const int base = Detail::ConsumeHexPrefix(value) ? 16 : 10;
+
+        char buffer[128];
+        const auto digits = Detail::StripSeparators(value, buffer);
+        if (!digits.has_value() || digits->empty())
+            return std::unexpected("Failed to parse integer");
+
+        U magnitude = 0;
+        const char *last = digits->data() + digits->size();
+        const auto [ptr, ec] = std::from_chars(digits->data(), last, magnitude, base);
+        if (ec == std::errc::result_out_of_range)
+            return std::unexpected("Integer out of range");
+        if (ec != std::errc() || ptr != last)
+            return std::unexpected("Failed to parse integer");
+
+        if constexpr (std::is_signed_v<T>) {
+            const U limit = static_cast<U>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+            if (magnitude > limit)
+                return std::unexpected("Integer out of range");
+            return negative ? static_cast<T>(U(0) - magnitude) : static_cast<T>(magnitude);
+        } else {
+            return magnitude;
+        }
+    }
+
+    // accepts an optional sign, 0x hex floats and '_' digit separators, the whole input has to be consumed
+    template<typename T>
+    std::expected<T, std::string> ParseFloat(std::string_view value) {
+        static_assert(std::is_floating_point_v<T>, "Unsupported float type");
+
+        if (value.empty())
+            return std::unexpected("String should not be empty");
+
+        const bool negative = value.front() == '-';
+        if (negative || value.front() == '+')
+            value.remove_prefix(1);
+
+        const auto format = Detail::ConsumeHexPrefix(value) ? std::chars_format::hex : std::chars_format::general;
+
+        char buffer[128];
+        const auto digits = Detail::StripSeparators(value, buffer);
+        if (!digits.has_value() || digits->empty() || digits->front() == '-' || digits->front() == '+')
+            return std::unexpected("Failed to parse float");
+
+        T result = 0;
+        const char *last = digits->data() + digits->size();
+        const auto [ptr, ec] = std::from_chars(digits->data(), last, result, format);
+        if (ec == std::errc::result_out_of_range)
+            return std::unexpected("Float out of range");
+        if (ec != std::errc() || ptr != last)
+            return std::unexpected("Failed to parse float");
+
+        return negative ? -result : result;
+    }
+
+    template<typename T>
+    struct Integer {
+        std::expected<T, std::string> operator()(std::string_view value) const {
+            return ParseInteger<T>(value);
+        }
+    };
+
+    template<typename T>
+    struct Float {
+        std::expected<T, std::string> operator()(std::string_view value) const {
+            return ParseFloat<T>(value);
+        }
+    };
+
+    template<typename T>
+    struct Boolean {
+        std::expected<T, std::string> operator()(std::string_view value) const {
+            if (value.empty())
+                return std::unexpected("String should not be empty");
+
+            if (value == "1" || value == "true") {
+                return true;
+            }
+            if (value == "0" || value == "false") {
+                return false;
+            }
+            return std::unexpected("Unsupported bool value (1/true/0/false)");
+        }
+    };
+
+    struct String {
+        std::expected<std::string, std::string> operator()(std::string_view value) const {
+            return std::string(value);
+        }
+    };
+
+    // Typed Validators
+
+    template<typename T>
+    struct Min {
+        T m_Min;
+
+        std::expected<T, std::string> operator()(T value) const {
+            if (value < m_Min)
+                return std::unexpected("Value should be >=" + std::to_string(m_Min));
+            return value;
+        }
+    };
+
+    template<typename T>
+    struct Max {
+        T m_Max;
+
+        std::expected<T, std::string> operator()(T value) const {
+            if (value > m_Max)
+                return std::unexpected("Value should be <=" + std::to_string(m_Max));
+            return value;
+        }
+    };
+
+    template<typename T>
+    struct Range {
+        T m_Min;
+        T m_Max;
+
+        std::expected<T, std::string> operator()(T value) const {
+            if (value < m_Min || value > m_Max)
+                return std::unexpected("Value should be >=" + std::to_string(m_Min) +
+                                       " and <=" + std::to_string(m_Max));
+            return value;
+        }
+    };
+
+    // Trim, NotEmpty, the numeric parser and the bound checks of a ValidatorBuilder fused into one callable
+    // the bounds are folded into one interval, only values outside of it walk the checks for their message
+    template<typename T>
+    struct NumericKernel {
+        using Bound = std::variant<Min<T>, Max<T>, Range<T> >;
+
+        bool m_Trim = false;
+        bool m_NotEmpty = false;
+        T m_Low = std::numeric_limits<T>::lowest();
+        T m_High = std::numeric_limits<T>::max();
+        std::vector<Bound> m_Bounds;
+
+        void AddBound(T Min, T Max, Bound Check) {
+            m_Low = std::max(m_Low, Min);
+            m_High = std::min(m_High, Max);
+            m_Bounds.push_back(std::move(Check));
+        }
+
+        std::expected<T, std::string> operator()(std::string_view value) const {
+            if (m_Trim)
+                value = *Trim()(value);
+            if (m_NotEmpty && value.empty())
+                return std::unexpected("Value should not be empty");
+
+            std::expected<T, std::string> parsed;
+            if constexpr (std::is_integral_v<T>)
+                parsed = ParseInteger<T>(value);
+            else
+                parsed = ParseFloat<T>(value);
+            if (!parsed.has_value())
+                return parsed;
+
+            // NaN passes the checks like it does in the pipeline
+            if (*parsed < m_Low || *parsed > m_High) [[unlikely]] {
+                for (const auto &bound: m_Bounds) {
+                    auto checked = std::visit([&parsed](const auto &check) { return check(*parsed); }, bound);
+                    if (!checked.has_value())
+                        return checked;
+                }
+            }
+            return parsed;
+        }
+
+        // the kernel in passes over the whole batch, see ValidatorPipeline::ValidateBatch for the contract
+        // the bound pass is a branch free loop over the parsed values that compilers vectorize
+        bool ValidateBatch(std::span<const std::string_view> values, std::span<T> out,
+                           std::vector<std::pair<size_t, std::string> > &errors) const {
+            const size_t count = std::min(values.size(), out.size());
+            const size_t before = errors.size();
+            std::vector<unsigned char> failed(count, 0);
+
+            for (size_t i = 0; i < count; ++i) {
+                std::string_view value = values[i];
+                if (m_Trim)
+                    value = *Trim()(value);
+                if (m_NotEmpty && value.empty()) {
+                    errors.emplace_back(i, "Value should not be empty");
+                    failed[i] = 1;
+                    out[i] = T();
+                    continue;
+                }
+
+                if constexpr (std::is_integral_v<T>) {
+                    if (Detail::ParseDigitRun(value, out[i]))
+                        continue;
+                }
+
+                std::expected<T, std::string> parsed;
+                if constexpr (std::is_integral_v<T>)
+                    parsed = ParseInteger<T>(value);
+                else
+                    parsed = ParseFloat<T>(value);
+                if (parsed.has_value()) {
+                    out[i] = *parsed;
+                } else {
+                    errors.emplace_back(i, std::move(parsed.error()));
+                    failed[i] = 1;
+                    out[i] = T();
+                }
+            }
+
+            std::vector<unsigned char> outside(count);
+            for (size_t i = 0; i < count; ++i)
+                outside[i] = (out[i] < m_Low) | (out[i] > m_High);
+
+            bool reordered = false;
+            for (size_t i = 0; i < count; ++i) {
+                if (!outside[i] || failed[i]) [[likely]]
+                    continue;
+                for (const auto &bound: m_Bounds) {
+                    auto checked = std::visit([&out, i](const auto &check) { return check(out[i]); }, bound);
+                    if (!checked.has_value()) {
+                        reordered = reordered || (errors.size() > before && errors.back().first > i);
+                        errors.emplace_back(i, std::move(checked.error()));
+                        break;
+                    }
+                }
+            }
+
+            if (reordered)
+                std::ranges::sort(errors.begin() + before, errors.end(), {}, &std::pair<size_t, std::string>::first);
+            return errors.size() == before;
+        }
+    };
+}
+
+#endif // CONFIG_STAGES_H
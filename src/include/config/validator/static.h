@@ -0,0 +1,121 @@
+#ifndef CONFIG_STATIC_H
+#define CONFIG_STATIC_H
+
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "stages.h"
+
+namespace ValidatorStages {
+    struct Pass {
+        std::expected<std::string_view, std::string> operator()(std::string_view value) const {
+            return value;
+        }
+    };
+
+    // runs First, then feeds its value into Second
+    template<typename First, typename Second>
+    struct Then {
+        First m_First;
+        Second m_Second;
+
+        template<typename V>
+        auto operator()(V &&value) const -> decltype(m_Second(std::move(*m_First(std::forward<V>(value))))) {
+            auto result = m_First(std::forward<V>(value));
+            if (!result.has_value())
+                return std::unexpected(std::move(result.error()));
+            return m_Second(std::move(result.value()));
+        }
+    };
+}
+
+// statically composed counterpart of ValidatorBuilder
+// every stage returns a new type, so the whole chain is one callable the compiler can inline
+template<typename T, typename F>
+class StaticTypedChain {
+    F m_Func;
+
+    template<typename G>
+    StaticTypedChain<T, ValidatorStages::Then<F, G> > Append(G stage) const {
+        return StaticTypedChain<T, ValidatorStages::Then<F, G> >({m_Func, std::move(stage)});
+    }
+
+public:
+    explicit StaticTypedChain(F func) : m_Func(std::move(func)) {
+    }
+
+    std::expected<T, std::string> operator()(std::string_view value) const {
+        return m_Func(value);
+    }
+
+    operator std::function<std::expected<T, std::string>(std::string_view)>() const {
+        return m_Func;
+    }
+
+    // Typed Validators
+
+    auto Min(T minValue) const { return Append(ValidatorStages::Min<T>{minValue}); }
+    auto Max(T maxValue) const { return Append(ValidatorStages::Max<T>{maxValue}); }
+    auto Range(T minValue, T maxValue) const { return Append(ValidatorStages::Range<T>{minValue, maxValue}); }
+
+    // Custom
+
+    template<typename G>
+    auto CustomTyped(G validator) const { return Append(std::move(validator)); }
+};
+
+template<typename T, typename F>
+class StaticStringChain {
+    F m_Func;
+
+    template<typename G>
+    StaticStringChain<T, ValidatorStages::Then<F, G> > Append(G stage) const {
+        return StaticStringChain<T, ValidatorStages::Then<F, G> >({m_Func, std::move(stage)});
+    }
+
+    template<typename P>
+    StaticTypedChain<T, ValidatorStages::Then<F, P> > Parse(P parser) const {
+        return StaticTypedChain<T, ValidatorStages::Then<F, P> >({m_Func, std::move(parser)});
+    }
+
+public:
+    explicit StaticStringChain(F func) : m_Func(std::move(func)) {
+    }
+
+    // strings need no parser
+    std::expected<T, std::string> operator()(std::string_view value) const requires std::is_same_v<T, std::string> {
+        return ValidatorStages::Then<F, ValidatorStages::String>{m_Func, {}}(value);
+    }
+
+    operator std::function<std::expected<T, std::string>(std::string_view)>() const requires std::is_same_v<T, std::string> {
+        return ValidatorStages::Then<F, ValidatorStages::String>{m_Func, {}};
+    }
+
+    // String Validators
+
+    auto Trim() const { return Append(ValidatorStages::Trim()); }
+    auto NotEmpty() const { return Append(ValidatorStages::NotEmpty()); }
+
+    template<typename G>
+    auto CustomView(G validator) const { return Append(std::move(validator)); }
+
+    // Parsers
+
+    auto Integer() const { return Parse(ValidatorStages::Integer<T>()); }
+    auto Float() const { return Parse(ValidatorStages::Float<T>()); }
+    auto Boolean() const { return Parse(ValidatorStages::Boolean<T>()); }
+    auto String() const { return Parse(ValidatorStages::String()); }
+
+    template<typename P>
+    auto Parser(P parser) const { return Parse(std::move(parser)); }
+};
+
+template<typename T>
+StaticStringChain<T, ValidatorStages::Pass> StaticValidator() {
+    return StaticStringChain<T, ValidatorStages::Pass>({});
+}
+
+#endif // CONFIG_STATIC_H
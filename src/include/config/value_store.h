@@ -0,0 +1,73 @@
+#ifndef CONFIG_VALUE_STORE_H
+#define CONFIG_VALUE_STORE_H
+
+#include <deque>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "variable.h"
+
+class IValuePool {
+public:
+    virtual ~IValuePool() = default;
+
+    virtual size_t Size() const = 0;
+
+    // resets every cell to its default, appends the names of the ones that changed
+    virtual void ResetAll(std::vector<std::string> &changed) = 0;
+};
+
+// hot values of one type, cells are packed next to each other in the blocks of a deque
+// defaults and names live in parallel arrays so bulk passes stay linear
+template<typename T>
+class CValuePool final : public IValuePool {
+    std::deque<CValueCell<T> > m_Cells;
+    std::deque<T> m_Defaults;
+    std::deque<std::string_view> m_Names;
+
+public:
+    // Name must outlive the pool
+    CValueCell<T> &Allocate(std::string_view Name, T Value, T DefaultValue) {
+        m_Cells.emplace_back(std::move(Value));
+        m_Defaults.push_back(std::move(DefaultValue));
+        m_Names.push_back(Name);
+        return m_Cells.back();
+    }
+
+    size_t Size() const override { return m_Cells.size(); }
+
+    void ResetAll(std::vector<std::string> &changed) override {
+        for (size_t i = 0; i < m_Cells.size(); ++i) {
+            const uint64_t revision = m_Cells[i].Revision();
+            m_Cells[i].Store(m_Defaults[i]);
+            if (m_Cells[i].Revision() != revision)
+                changed.emplace_back(m_Names[i]);
+        }
+    }
+};
+
+// type segregated storage owned by the registry, only touched under its writer lock
+class CValueStore {
+    std::unordered_map<std::type_index, std::unique_ptr<IValuePool> > m_Pools;
+
+public:
+    template<typename T>
+    CValuePool<T> &Pool() {
+        auto &pool = m_Pools[typeid(T)];
+        if (!pool)
+            pool = std::make_unique<CValuePool<T> >();
+        return static_cast<CValuePool<T> &>(*pool);
+    }
+
+    void ResetAll(std::vector<std::string> &changed) {
+        for (const auto &pool: m_Pools | std::views::values)
+            pool->ResetAll(changed);
+    }
+};
+
+#endif // CONFIG_VALUE_STORE_H
@@ -1,17 +1,118 @@
 #ifndef CONFIG_VARIABLE_H
 #define CONFIG_VARIABLE_H
 
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <functional>
 #include <expected>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <typeindex>
 #include <utility>
+#include <vector>
 
 #include <config/external/json.hpp>
 
+#include "composite.h"
+
 using namespace nlohmann;
 
+// atomic storage for the current value, cheap trivially copyable types are kept inline,
+// everything else is published as an immutable shared copy
+// stores are serialized by the registry, the revision only moves when the value actually changes
+// types without operator== count every store as a change
+template<typename T>
+constexpr bool IsInlineValue() {
+    if constexpr (std::is_trivially_copyable_v<T>)
+        return std::atomic<T>::is_always_lock_free;
+    else
+        return false;
+}
+
+template<typename T, bool Inline = IsInlineValue<T>()>
+class CValueCell;
+
+template<typename T>
+class CValueCell<T, true> {
+    std::atomic<T> m_Value;
+    std::atomic<uint64_t> m_Revision = 0;
+
+public:
+    explicit CValueCell(T Value) : m_Value(Value) {
+    }
+
+    T Load() const { return m_Value.load(std::memory_order_acquire); }
+    uint64_t Revision() const { return m_Revision.load(std::memory_order_acquire); }
+
+    void Store(T Value) {
+        if constexpr (std::equality_comparable<T>) {
+            if (m_Value.load(std::memory_order_relaxed) == Value)
+                return;
+        }
+        m_Value.store(Value, std::memory_order_release);
+        m_Revision.fetch_add(1, std::memory_order_release);
+    }
+};
+
+template<typename T>
+class CValueCell<T, false> {
+    std::atomic<std::shared_ptr<const T> > m_Value;
+    std::atomic<uint64_t> m_Revision = 0;
+
+public:
+    explicit CValueCell(T Value) : m_Value(std::make_shared<const T>(std::move(Value))) {
+    }
+
+    T Load() const { return *LoadShared(); }
+    // the current value without copying it, stays valid and unchanged while the caller holds it
+    std::shared_ptr<const T> LoadShared() const { return m_Value.load(std::memory_order_acquire); }
+    uint64_t Revision() const { return m_Revision.load(std::memory_order_acquire); }
+
+    void Store(T Value) {
+        if constexpr (std::equality_comparable<T>) {
+            if (*m_Value.load(std::memory_order_relaxed) == Value)
+                return;
+        }
+        m_Value.store(std::make_shared<const T>(std::move(Value)), std::memory_order_release);
+        m_Revision.fetch_add(1, std::memory_order_release);
+    }
+};
+
+// turns the raw text of a value into T, failing with a readable message
+template<typename T>
+using ConfigValidator = std::function<std::expected<T, std::string>(std::string_view)>;
+
+// composite values arrive already converted, their validator only checks the result
+template<typename T>
+using ConfigCheck = std::function<std::expected<void, std::string>(const T &)>;
+
+template<typename T>
+using ConfigValidatorOf = std::conditional_t<IsCompositeValue<T>(), ConfigCheck<T>, ConfigValidator<T> >;
+
+// accepts validators taking std::string_view as well as older ones taking std::string
+// composite values take a check on the converted value or nullptr for none
+template<typename T, typename V>
+ConfigValidatorOf<T> MakeValidator(V &&Validator) {
+    if constexpr (IsCompositeValue<T>()) {
+        if constexpr (std::is_null_pointer_v<std::decay_t<V> >)
+            return {};
+        else
+            return ConfigCheck<T>(std::forward<V>(Validator));
+    } else if constexpr (std::is_invocable_v<std::decay_t<V> &, std::string_view>) {
+        return ConfigValidator<T>(std::forward<V>(Validator));
+    } else {
+        return [Validator = std::forward<V>(Validator)](std::string_view Value) {
+            return Validator(std::string(Value));
+        };
+    }
+}
+
 // abstract class for typeless storage
 class IConfigVariableBase {
 public:
@@ -35,36 +136,205 @@ public:
 
     virtual std::optional<std::string_view> Description() const = 0;
 
-    virtual std::expected<void, std::string> TrySet(const std::string &value, bool Init = false) = 0;
+    // changes every time the stored value changes
+    virtual uint64_t Revision() const = 0;
+
+    virtual std::expected<void, std::string> TrySet(std::string_view value, bool Init = false) = 0;
 
     virtual std::expected<void, std::string> TrySetJson(const json &value, bool Init = false) = 0;
 
+    // two phase TrySet and TrySetJson for batches: staging converts and validates without storing and may
+    // run concurrently for different variables, CommitStaged stores the result under the writer lock
+    virtual std::expected<void, std::string> Stage(std::string_view value, bool Init = false) = 0;
+
+    virtual std::expected<void, std::string> StageJson(const json &value, bool Init = false) = 0;
+
+    // stages the default value, Reset() in two phases
+    virtual void StageDefault() = 0;
+
+    // writes one element inside a list, map or struct value, Path is like a json pointer: "/hosts/2"
+    virtual std::expected<void, std::string> SetNested(std::string_view Path, const json &value, bool Init = false) = 0;
+
+    virtual void CommitStaged() = 0;
+
+    virtual void DiscardStaged() = 0;
+
+    // lazy loading: keeps the raw value, it is converted and validated by the first read
+    virtual void Defer(json value) = 0;
+
+    // converts a deferred value now, keeps failing with its error until the variable is written again
+    virtual std::expected<void, std::string> Resolve() const = 0;
+
+    virtual void DropDeferred() = 0;
+
     virtual void Reset() = 0;
+
+    // independent copy with its own value cell, same name, default, validator and current value
+    virtual std::unique_ptr<IConfigVariableBase> Clone() const = 0;
+};
+
+// raw json left behind by a lazy load, the first reader converts it under the shared mutex
+// movable so a variable can still be handed to the registry by value, it must not move once shared
+class CDeferredValue {
+public:
+    enum EState : uint8_t {
+        STATE_NONE,
+        STATE_PENDING,
+        STATE_FAILED,
+    };
+
+private:
+    std::atomic<EState> m_State = STATE_NONE;
+    json m_Raw;
+    std::string m_Error;
+
+public:
+    CDeferredValue() = default;
+
+    CDeferredValue(CDeferredValue &&Other) noexcept
+        : m_State(Other.m_State.load(std::memory_order_relaxed)), m_Raw(std::move(Other.m_Raw)), m_Error(std::move(Other.m_Error)) {
+    }
+
+    // resolution is rare, one mutex for all variables keeps them small
+    static std::mutex &Mutex() {
+        static std::mutex s_Mutex;
+        return s_Mutex;
+    }
+
+    EState State() const { return m_State.load(std::memory_order_acquire); }
+
+    // everything below is called with Mutex() held
+
+    const json &Raw() const { return m_Raw; }
+    const std::string &Error() const { return m_Error; }
+
+    void Defer(json Raw) {
+        m_Raw = std::move(Raw);
+        m_Error.clear();
+        m_State.store(STATE_PENDING, std::memory_order_release);
+    }
+
+    void Settle(std::string Error) {
+        m_Raw = nullptr;
+        m_Error = std::move(Error);
+        m_State.store(m_Error.empty() ? STATE_NONE : STATE_FAILED, std::memory_order_release);
+    }
+
+    void Clear() { Settle({}); }
+};
+
+// compile-time metadata of the supported value types
+template<typename T>
+struct SConfigType {
+    static constexpr bool s_Known = false;
+};
+
+template<>
+struct SConfigType<std::string> {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "string";
+};
+
+template<>
+struct SConfigType<int> {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "integer";
+};
+
+template<>
+struct SConfigType<float> {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "float";
+};
+
+template<>
+struct SConfigType<bool> {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "boolean";
+};
+
+template<typename U, typename A>
+struct SConfigType<std::vector<U, A> > {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "list";
+};
+
+template<typename U, typename C, typename A>
+struct SConfigType<std::map<std::string, U, C, A> > {
+    static constexpr bool s_Known = true;
+    static constexpr std::string_view s_Name = "map";
 };
 
 template<typename T>
 class CConfigVariable : public IConfigVariableBase {
     bool m_ReadOnly;
     std::string m_Name;
-    T m_Value;
+    // points at m_OwnedValue until the registry moves the value into its flat storage
+    CValueCell<T> *m_pValue;
+    std::unique_ptr<CValueCell<T> > m_OwnedValue;
     T m_DefaultValue;
     std::optional<std::string> m_Description;
-    std::function<std::expected<T, std::string>(std::string)> m_Validator;
+    ConfigValidatorOf<T> m_Validator;
+    mutable CDeferredValue m_Deferred;
+    std::optional<T> m_Staged;
 
-    std::map<std::type_index, std::string_view> m_TypeNames = {
-        {typeid(std::string), "string"},
-        {typeid(int), "integer"},
-        {typeid(float), "float"},
-        {typeid(bool), "boolean"},
-    };
+    // json type checked like get<T>(), the value itself goes through the validator as text
+    // composite values are converted once here and only checked, reads hand out the native value
+    std::expected<T, std::string> FromJson(const json &Value) const {
+        try {
+            if constexpr (IsCompositeValue<T>()) {
+                T value = Value.get<T>();
+                if (m_Validator) {
+                    if (auto checked = m_Validator(value); !checked.has_value())
+                        return std::unexpected(checked.error());
+                }
+                return value;
+            } else {
+                (void) Value.get<T>();
+                if (Value.is_string())
+                    return m_Validator(Value.get_ref<const std::string &>());
+                return m_Validator(Value.dump());
+            }
+        } catch (const json::exception &e) {
+            return std::unexpected("JSON parse error: " + std::string(e.what()));
+        }
+    }
+
+    // the text of a composite value is its json form
+    std::expected<T, std::string> FromText(std::string_view Value) const {
+        if constexpr (IsCompositeValue<T>()) {
+            try {
+                return FromJson(json::parse(Value));
+            } catch (const json::exception &e) {
+                return std::unexpected("JSON parse error: " + std::string(e.what()));
+            }
+        } else {
+            return m_Validator(Value);
+        }
+    }
+
+    // writes are serialized by the registry, a deferred value is dropped in favour of the new one
+    void Store(T Value) {
+        if (m_Deferred.State() != CDeferredValue::STATE_NONE) [[unlikely]]
+            DropDeferred();
+        m_pValue->Store(std::move(Value));
+    }
 
 public:
+    template<typename V>
     CConfigVariable(std::string Name,
                     T DefaultValue,
-                    std::function<std::expected<T, std::string>(std::string)> Validator,
+                    V &&Validator,
                     const std::optional<std::string> &Description = std::nullopt, bool ReadOnly = false)
-        : m_ReadOnly(ReadOnly), m_Name(std::move(Name)), m_Value(DefaultValue), m_DefaultValue(DefaultValue), m_Description(Description),
-          m_Validator(std::move(Validator)) {
+        : m_ReadOnly(ReadOnly), m_Name(std::move(Name)), m_OwnedValue(std::make_unique<CValueCell<T> >(DefaultValue)), m_DefaultValue(DefaultValue), m_Description(Description),
+          m_Validator(MakeValidator<T>(std::forward<V>(Validator))) {
+        m_pValue = m_OwnedValue.get();
+    }
+
+    // moves the value into externally owned storage, must happen before the variable is shared
+    void BindCell(CValueCell<T> &Cell) {
+        m_pValue = &Cell;
+        m_OwnedValue.reset();
     }
 
     bool ReadOnly() const override { return m_ReadOnly; }
@@ -72,18 +342,21 @@ public:
     std::type_index Type() const override { return typeid(T); }
 
     std::string_view TypeString() const override {
-        if (m_TypeNames.contains(Type()))
-            return m_TypeNames.at(Type());
-        return Type().name();
+        if constexpr (SConfigType<T>::s_Known)
+            return SConfigType<T>::s_Name;
+        else
+            return Type().name();
     }
 
     std::string ValueAsString() const override {
         if constexpr (std::is_same_v<T, std::string>) {
-            return m_Value;
+            return Value();
         } else if constexpr (std::is_same_v<T, bool>) {
-            return m_Value ? "true" : "false";
+            return Value() ? "true" : "false";
+        } else if constexpr (IsCompositeValue<T>()) {
+            return ValueAsJson().dump();
         } else {
-            return std::to_string(m_Value);
+            return std::to_string(Value());
         }
     }
 
@@ -92,13 +365,18 @@ public:
             return m_DefaultValue;
         } else if constexpr (std::is_same_v<T, bool>) {
             return m_DefaultValue ? "true" : "false";
+        } else if constexpr (IsCompositeValue<T>()) {
+            return DefaultValueAsJson().dump();
         } else {
             return std::to_string(m_DefaultValue);
         }
     }
 
     json ValueAsJson() const override {
-        return json(Value());
+        if constexpr (IsInlineValue<T>())
+            return json(Value());
+        else
+            return json(*SharedValue());
     }
 
     json DefaultValueAsJson() const override {
@@ -106,20 +384,35 @@ public:
     }
 
     std::string_view Name() const override { return m_Name; }
-    T Value() const { return m_Value; }
-    T DefaultValue() const { return m_DefaultValue; }
+    T Value() const {
+        if (Pending()) [[unlikely]]
+            (void) Resolve();
+        return m_pValue->Load();
+    }
+
+    // only for values stored out of line, see IsInlineValue
+    std::shared_ptr<const T> SharedValue() const requires (!IsInlineValue<T>()) {
+        if (Pending()) [[unlikely]]
+            (void) Resolve();
+        return m_pValue->LoadShared();
+    }
+
+    bool Pending() const { return m_Deferred.State() == CDeferredValue::STATE_PENDING; }
+    const CValueCell<T> &Cell() const { return *m_pValue; }
+    const T &DefaultValue() const { return m_DefaultValue; }
     std::optional<std::string_view> Description() const override { return m_Description; }
+    uint64_t Revision() const override { return m_pValue->Revision(); }
 
-    void Set(T Value) { m_Value = Value; }
+    void Set(T Value) { Store(std::move(Value)); }
 
-    std::expected<void, std::string> TrySet(const std::string &Value, bool Init = false) override {
+    std::expected<void, std::string> TrySet(std::string_view Value, bool Init = false) override {
         if (!Init && m_ReadOnly) {
             return std::unexpected("Variable is read-only");
         }
 
-        auto result = m_Validator(Value);
+        auto result = FromText(Value);
         if (result.has_value()) {
-            m_Value = result.value();
+            Store(std::move(result.value()));
             return {};
         }
         return std::unexpected(result.error());
@@ -130,16 +423,170 @@ public:
             return std::unexpected("Variable is read-only");
         }
 
-        try {
-            T typedValue = Value.get<T>();
-            m_Value = typedValue;
+        auto result = FromJson(Value);
+        if (result.has_value()) {
+            Store(std::move(result.value()));
+            return {};
+        }
+        return std::unexpected(result.error());
+    }
+
+    std::expected<void, std::string> Stage(std::string_view Value, bool Init = false) override {
+        if (!Init && m_ReadOnly) {
+            return std::unexpected("Variable is read-only");
+        }
+
+        auto result = FromText(Value);
+        if (!result.has_value())
+            return std::unexpected(result.error());
+        m_Staged = std::move(result.value());
+        return {};
+    }
+
+    std::expected<void, std::string> StageJson(const json &Value, bool Init = false) override {
+        if (!Init && m_ReadOnly) {
+            return std::unexpected("Variable is read-only");
+        }
+
+        auto result = FromJson(Value);
+        if (!result.has_value())
+            return std::unexpected(result.error());
+        m_Staged = std::move(result.value());
+        return {};
+    }
+
+    void StageDefault() override { m_Staged = m_DefaultValue; }
+
+    // copies the current value and converts only the element at Path, the check still sees the whole value
+    std::expected<void, std::string> SetNested(std::string_view Path, const json &Value, bool Init = false) override {
+        if (!Init && m_ReadOnly) {
+            return std::unexpected("Variable is read-only");
+        }
+
+        if constexpr (!IsCompositeValue<T>()) {
+            return std::unexpected("Variable has no nested values");
+        } else {
+            T value = this->Value();
+            try {
+                if (auto assigned = SNestedAccess<T>::Assign(value, Path, Value); !assigned.has_value())
+                    return assigned;
+            } catch (const json::exception &e) {
+                return std::unexpected("JSON parse error: " + std::string(e.what()));
+            }
+            if (m_Validator) {
+                if (auto checked = m_Validator(value); !checked.has_value())
+                    return std::unexpected(checked.error());
+            }
+            Store(std::move(value));
             return {};
-        } catch (const json::exception &e) {
-            return std::unexpected("JSON parse error: " + std::string(e.what()));
         }
     }
 
-    void Reset() override { m_Value = m_DefaultValue; }
+    void CommitStaged() override {
+        if (!m_Staged.has_value())
+            return;
+        Store(std::move(*m_Staged));
+        m_Staged.reset();
+    }
+
+    void DiscardStaged() override { m_Staged.reset(); }
+
+    void Defer(json Value) override {
+        std::lock_guard lock(CDeferredValue::Mutex());
+        m_Deferred.Defer(std::move(Value));
+    }
+
+    std::expected<void, std::string> Resolve() const override {
+        std::lock_guard lock(CDeferredValue::Mutex());
+        if (m_Deferred.State() == CDeferredValue::STATE_PENDING) {
+            auto result = FromJson(m_Deferred.Raw());
+            if (result.has_value())
+                m_pValue->Store(std::move(result.value()));
+            m_Deferred.Settle(result.has_value() ? std::string() : std::move(result.error()));
+        }
+
+        if (m_Deferred.State() == CDeferredValue::STATE_FAILED)
+            return std::unexpected(m_Deferred.Error());
+        return {};
+    }
+
+    void DropDeferred() override {
+        std::lock_guard lock(CDeferredValue::Mutex());
+        m_Deferred.Clear();
+    }
+
+    void Reset() override { Store(m_DefaultValue); }
+
+    std::unique_ptr<IConfigVariableBase> Clone() const override {
+        auto copy = std::make_unique<CConfigVariable<T> >(m_Name, m_DefaultValue, m_Validator, m_Description, m_ReadOnly);
+        copy->Set(Value());
+        return copy;
+    }
+};
+
+// typed read-only view of a registered variable, valid for the lifetime of its registry
+template<typename T>
+class CConfigHandle {
+    const CConfigVariable<T> *m_pVariable = nullptr;
+    const CValueCell<T> *m_pCell = nullptr;
+    // generation of the owning registry, moves on every committed write
+    const std::atomic<uint64_t> *m_pGeneration = nullptr;
+
+    struct SCacheSlot {
+        const CValueCell<T> *m_pCell = nullptr;
+        const std::atomic<uint64_t> *m_pGeneration = nullptr;
+        uint64_t m_Generation = 0;
+        std::optional<T> m_Value;
+    };
+
+public:
+    CConfigHandle() = default;
+
+    explicit CConfigHandle(const CConfigVariable<T> &Variable, const std::atomic<uint64_t> *pGeneration = nullptr)
+        : m_pVariable(&Variable), m_pCell(&Variable.Cell()), m_pGeneration(pGeneration) {
+    }
+
+    bool Valid() const { return m_pCell != nullptr; }
+    explicit operator bool() const { return Valid(); }
+
+    std::string_view Name() const { return m_pVariable->Name(); }
+
+    T Get() const {
+        if (m_pVariable->Pending()) [[unlikely]]
+            (void) m_pVariable->Resolve();
+        return m_pCell->Load();
+    }
+
+    T operator*() const { return Get(); }
+
+    // no allocation and no copy for strings and other out of line values, a concurrent Set publishes
+    // a new value and leaves the one held here alone
+    std::shared_ptr<const T> Shared() const requires (!IsInlineValue<T>()) {
+        if (m_pVariable->Pending()) [[unlikely]]
+            (void) m_pVariable->Resolve();
+        return m_pCell->LoadShared();
+    }
+
+    // per thread copy of the value, refreshed when the registry generation moves
+    // a hit only reads the generation, which stays in every core's cache until somebody writes
+    T Cached() const {
+        if (!m_pGeneration)
+            return Get();
+
+        thread_local std::array<SCacheSlot, 64> s_aSlots;
+        const auto key = reinterpret_cast<uintptr_t>(m_pCell) * 0x9e3779b97f4a7c15ull;
+        SCacheSlot &slot = s_aSlots[key >> 58];
+
+        // acquire pairs with the bump after the store, a generation that moved always brings the new value along
+        const uint64_t generation = m_pGeneration->load(std::memory_order_acquire);
+        if (slot.m_pCell != m_pCell || slot.m_pGeneration != m_pGeneration || slot.m_Generation != generation) [[unlikely]] {
+            slot.m_Value = Get();
+            slot.m_pCell = m_pCell;
+            slot.m_pGeneration = m_pGeneration;
+            slot.m_Generation = generation;
+        }
+        return *slot.m_Value;
+    }
 };
 
 #endif // CONFIG_VARIABLE_H
@@ -0,0 +1,92 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "registry.h"
+
+// opt-in hot reload, probes the file's mtime and size and reapplies only what changed
+class CConfigWatcher {
+    CConfigRegistry &m_Registry;
+    std::string m_Path;
+
+    std::mutex m_PollMutex;
+    std::filesystem::file_time_type m_LastWriteTime{};
+    std::uintmax_t m_LastSize = 0;
+    bool m_Probed = false;
+
+    std::mutex m_SleepMutex;
+    std::condition_variable_any m_Wakeup;
+    std::jthread m_Thread;
+
+public:
+    CConfigWatcher(CConfigRegistry &Registry, std::string Path) : m_Registry(Registry), m_Path(std::move(Path)) {
+    }
+
+    ~CConfigWatcher() { Stop(); }
+
+    CConfigWatcher(const CConfigWatcher &) = delete;
+    CConfigWatcher &operator=(const CConfigWatcher &) = delete;
+
+    const std::string &Path() const { return m_Path; }
+
+    // returns true if the file changed and was reapplied
+    std::expected<bool, std::string> Poll() {
+        std::lock_guard lock(m_PollMutex);
+
+        std::error_code ec;
+        const auto writeTime = std::filesystem::last_write_time(m_Path, ec);
+        if (ec)
+            return std::unexpected("Failed to stat " + m_Path + ": " + ec.message());
+        const auto size = std::filesystem::file_size(m_Path, ec);
+        if (ec)
+            return std::unexpected("Failed to stat " + m_Path + ": " + ec.message());
+
+        if (m_Probed && writeTime == m_LastWriteTime && size == m_LastSize)
+            return false;
+
+        auto result = m_Registry.ReloadFromFile(m_Path);
+
+        // a partially invalid file still counts as applied, a file that failed to parse is retried
+        if (result.has_value() || !result.error().starts_with("JSON parse error")) {
+            m_LastWriteTime = writeTime;
+            m_LastSize = size;
+            m_Probed = true;
+        }
+
+        if (!result.has_value())
+            return std::unexpected(result.error());
+        return true;
+    }
+
+    void Start(std::chrono::milliseconds Interval, std::function<void(const std::string &)> OnError = {}) {
+        Stop();
+        m_Thread = std::jthread([this, Interval, OnError = std::move(OnError)](std::stop_token Token) {
+            while (!Token.stop_requested()) {
+                auto result = Poll();
+                if (!result.has_value() && OnError)
+                    OnError(result.error());
+
+                std::unique_lock lock(m_SleepMutex);
+                m_Wakeup.wait_for(lock, Token, Interval, [] { return false; });
+            }
+        });
+    }
+
+    void Stop() {
+        if (!m_Thread.joinable())
+            return;
+        m_Thread.request_stop();
+        m_Thread.join();
+    }
+};
+
+#endif // CONFIG_WATCHER_H
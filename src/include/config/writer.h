@@ -0,0 +1,371 @@
+#ifndef CONFIG_WRITER_H
+#define CONFIG_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <config/external/json.hpp>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace nlohmann;
+
+// writes a file next to the target and renames it into place on Commit()
+// readers of the path see either the old or the new contents, never a truncated file
+class CAtomicFile {
+    std::string m_Path;
+    std::string m_TempPath;
+    std::string m_Error;
+    uint64_t m_Written = 0;
+    bool m_Committed = false;
+#if defined(_WIN32)
+    std::ofstream m_File;
+#else
+    int m_Fd = -1;
+
+    void Fail(const char *pWhat) {
+        if (m_Error.empty())
+            m_Error = std::string(pWhat) + " " + m_TempPath + ": " + std::strerror(errno);
+    }
+#endif
+
+public:
+    explicit CAtomicFile(std::string Path) : m_Path(std::move(Path)) {
+#if defined(_WIN32)
+        m_TempPath = m_Path + ".tmp";
+        m_File.open(m_TempPath, std::ios::binary | std::ios::trunc);
+        if (!m_File.is_open())
+            m_Error = "Failed to open file for writing: " + m_TempPath;
+#else
+        m_TempPath = m_Path + ".XXXXXX";
+        m_Fd = mkstemp(m_TempPath.data());
+        if (m_Fd < 0) {
+            Fail("Failed to create");
+            return;
+        }
+
+        // keep the mode of the file we replace, mkstemp always creates 0600
+        struct stat st{};
+        const mode_t mode = stat(m_Path.c_str(), &st) == 0 ? st.st_mode & 07777 : 0644;
+        if (fchmod(m_Fd, mode) != 0)
+            Fail("Failed to chmod");
+#endif
+    }
+
+    ~CAtomicFile() {
+        if (m_Committed)
+            return;
+#if defined(_WIN32)
+        m_File.close();
+#else
+        if (m_Fd >= 0)
+            close(m_Fd);
+#endif
+        std::error_code ec;
+        std::filesystem::remove(m_TempPath, ec);
+    }
+
+    CAtomicFile(const CAtomicFile &) = delete;
+    CAtomicFile &operator=(const CAtomicFile &) = delete;
+
+    bool Ok() const { return m_Error.empty(); }
+    uint64_t Written() const { return m_Written; }
+
+    void Write(std::string_view Data) {
+        if (!Ok())
+            return;
+        m_Written += Data.size();
+#if defined(_WIN32)
+        m_File.write(Data.data(), static_cast<std::streamsize>(Data.size()));
+        if (!m_File)
+            m_Error = "Failed to write " + m_TempPath;
+#else
+        while (!Data.empty()) {
+            const ssize_t written = write(m_Fd, Data.data(), Data.size());
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                Fail("Failed to write");
+                return;
+            }
+            Data.remove_prefix(static_cast<size_t>(written));
+        }
+#endif
+    }
+
+    // flushes to disk and replaces the target
+    std::expected<void, std::string> Commit() {
+        if (!Ok())
+            return std::unexpected(m_Error);
+#if defined(_WIN32)
+        m_File.close();
+        if (!m_File)
+            return std::unexpected("Failed to write " + m_TempPath);
+        std::error_code ec;
+        std::filesystem::rename(m_TempPath, m_Path, ec);
+        if (ec)
+            return std::unexpected("Failed to replace " + m_Path + ": " + ec.message());
+#else
+        if (fsync(m_Fd) != 0)
+            Fail("Failed to sync");
+        if (close(m_Fd) != 0)
+            Fail("Failed to close");
+        m_Fd = -1;
+        if (!Ok())
+            return std::unexpected(m_Error);
+
+        if (rename(m_TempPath.c_str(), m_Path.c_str()) != 0)
+            return std::unexpected("Failed to replace " + m_Path + ": " + std::strerror(errno));
+
+        // make the rename itself durable
+        const std::filesystem::path parent = std::filesystem::path(m_Path).parent_path();
+        const int dirFd = open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+#endif
+        m_Committed = true;
+        return {};
+    }
+};
+
+// CJsonWriter sinks for in-memory output
+class CStringSink {
+    std::string &m_Out;
+
+public:
+    explicit CStringSink(std::string &Out) : m_Out(Out) {
+    }
+
+    void Write(std::string_view Data) { m_Out.append(Data); }
+};
+
+template<typename OutputIt>
+class CIteratorSink {
+    OutputIt m_It;
+
+public:
+    explicit CIteratorSink(OutputIt It) : m_It(std::move(It)) {
+    }
+
+    void Write(std::string_view Data) { m_It = std::copy(Data.begin(), Data.end(), std::move(m_It)); }
+
+    OutputIt It() const { return m_It; }
+};
+
+// streams a nested json document built from dotted names straight into a sink, no document is built
+// names have to come grouped by prefix, like CPathIndex::ForEach produces them
+// Indent follows json::dump(): negative for compact output
+template<typename Sink>
+class CJsonWriter {
+    static constexpr size_t s_BufferSize = 64 * 1024;
+
+    Sink &m_Sink;
+    int m_Indent;
+    std::string m_Buffer;
+    std::vector<std::string_view> m_Open;
+    std::vector<std::string_view> m_Segments;
+    std::vector<bool> m_HasMembers;
+    std::string_view m_LastLeaf;
+
+    void Flush() {
+        m_Sink.Write(m_Buffer);
+        m_Buffer.clear();
+    }
+
+    void Put(std::string_view Data) {
+        m_Buffer.append(Data);
+        if (m_Buffer.size() >= s_BufferSize)
+            Flush();
+    }
+
+    void Put(char c) {
+        m_Buffer.push_back(c);
+        if (m_Buffer.size() >= s_BufferSize)
+            Flush();
+    }
+
+    void NewLine(size_t Depth) {
+        if (m_Indent < 0)
+            return;
+        Put('\n');
+        m_Buffer.append(Depth * static_cast<size_t>(m_Indent), ' ');
+    }
+
+    // length of the multi-byte UTF-8 sequence at Value[i], 0 if it is ill-formed
+    static size_t Utf8Length(std::string_view Value, size_t i) {
+        const auto byte = [Value](size_t j) { return static_cast<unsigned char>(Value[j]); };
+        const unsigned char lead = byte(i);
+        size_t length = 0;
+        unsigned char low = 0x80, high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            length = 2;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            low = lead == 0xe0 ? 0xa0 : 0x80;
+            high = lead == 0xed ? 0x9f : 0xbf;
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            low = lead == 0xf0 ? 0x90 : 0x80;
+            high = lead == 0xf4 ? 0x8f : 0xbf;
+        }
+        if (length == 0 || i + length > Value.size() || byte(i + 1) < low || byte(i + 1) > high)
+            return 0;
+        for (size_t j = i + 2; j < i + length; ++j) {
+            if (byte(j) < 0x80 || byte(j) > 0xbf)
+                return 0;
+        }
+        return length;
+    }
+
+    // ill-formed UTF-8 throws type_error 316 like json::dump(), before anything is committed
+    void PutString(std::string_view Value) {
+        static constexpr char s_aHex[] = "0123456789abcdef";
+        Put('"');
+        for (size_t i = 0; i < Value.size(); ++i) {
+            const char c = Value[i];
+            if (static_cast<unsigned char>(c) >= 0x80) {
+                const size_t length = Utf8Length(Value, i);
+                if (length == 0) {
+                    char aByte[3];
+                    std::snprintf(aByte, sizeof(aByte), "%02X", static_cast<unsigned char>(c));
+                    throw json::type_error::create(316, "invalid UTF-8 byte at index " + std::to_string(i) + ": 0x" + aByte, nullptr);
+                }
+                Put(Value.substr(i, length));
+                i += length - 1;
+                continue;
+            }
+            switch (c) {
+                case '"': Put("\\\""); break;
+                case '\\': Put("\\\\"); break;
+                case '\b': Put("\\b"); break;
+                case '\f': Put("\\f"); break;
+                case '\n': Put("\\n"); break;
+                case '\r': Put("\\r"); break;
+                case '\t': Put("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        Put("\\u00");
+                        Put(s_aHex[c >> 4]);
+                        Put(s_aHex[c & 0xf]);
+                    } else {
+                        Put(c);
+                    }
+            }
+        }
+        Put('"');
+    }
+
+    void PutKey(std::string_view Key) {
+        const size_t depth = m_HasMembers.size();
+        if (m_HasMembers.back())
+            Put(',');
+        m_HasMembers.back() = true;
+        NewLine(depth);
+        PutString(Key);
+        Put(m_Indent < 0 ? ":" : ": ");
+    }
+
+    void PutValue(const json &Value, size_t Depth) {
+        if (Value.is_string()) {
+            PutString(Value.get_ref<const std::string &>());
+        } else if (Value.is_object() || Value.is_array()) {
+            if (Value.empty()) {
+                Put(Value.is_object() ? "{}" : "[]");
+                return;
+            }
+            Put(Value.is_object() ? '{' : '[');
+            bool first = true;
+            for (auto it = Value.begin(); it != Value.end(); ++it) {
+                if (!first)
+                    Put(',');
+                first = false;
+                NewLine(Depth + 1);
+                if (Value.is_object()) {
+                    PutString(it.key());
+                    Put(m_Indent < 0 ? ":" : ": ");
+                }
+                PutValue(*it, Depth + 1);
+            }
+            NewLine(Depth);
+            Put(Value.is_object() ? '}' : ']');
+        } else {
+            Put(Value.dump());
+        }
+    }
+
+    void CloseTo(size_t Depth) {
+        while (m_Open.size() > Depth) {
+            m_Open.pop_back();
+            m_HasMembers.pop_back();
+            NewLine(m_HasMembers.size());
+            Put('}');
+        }
+    }
+
+public:
+    CJsonWriter(Sink &Out, int Indent) : m_Sink(Out), m_Indent(Indent) {
+        m_Buffer.reserve(s_BufferSize + 1024);
+        m_HasMembers.push_back(false);
+        Put('{');
+    }
+
+    void Member(std::string_view Name, const json &Value) {
+        // a variable nested below another variable can't be represented, the outer one wins
+        if (!m_LastLeaf.empty() && Name.size() > m_LastLeaf.size() && Name.starts_with(m_LastLeaf) &&
+            Name[m_LastLeaf.size()] == '.')
+            return;
+        m_LastLeaf = Name;
+
+        auto &segments = m_Segments;
+        segments.clear();
+        for (size_t start = 0;;) {
+            const size_t dot = Name.find('.', start);
+            segments.push_back(Name.substr(start, dot - start));
+            if (dot == std::string_view::npos)
+                break;
+            start = dot + 1;
+        }
+
+        size_t common = 0;
+        while (common < m_Open.size() && common + 1 < segments.size() && m_Open[common] == segments[common])
+            ++common;
+        CloseTo(common);
+
+        for (size_t i = common; i + 1 < segments.size(); ++i) {
+            PutKey(segments[i]);
+            Put('{');
+            m_Open.push_back(segments[i]);
+            m_HasMembers.push_back(false);
+        }
+
+        PutKey(segments.back());
+        PutValue(Value, m_HasMembers.size());
+    }
+
+    void Finish() {
+        CloseTo(0);
+        if (m_HasMembers.back())
+            NewLine(0);
+        Put('}');
+        Flush();
+    }
+};
+
+#endif // CONFIG_WRITER_H
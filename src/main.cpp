@@ -6,15 +6,18 @@
 
 int main() {
     CONFIG_STRING_READONLY("veryImportantString", "fas", Validators::StringNonEmpty());
-    CONFIG_INT("integer", 512, Validators::IntRanged(0, 500));
+    const auto integer = CONFIG_INT("integer", 512, Validators::IntRanged(0, 500));
     CONFIG_FLOAT("getReal", 22.8, Validators::FloatRanged(0, 200));
 
     Config().LoadFromFile("config.json");
 
-    for (const auto &var: Config().ListAll()) {
-        auto info = *Config().GetInfo(var);
-        std::println(std::cout, "{}: {} = {}(def: {})", info.name, info.type, info.value, info.default_value);
-    }
+    std::string value, defaultValue;
+    Config().ForEachInfo([&](const SVariableInfoView &info) {
+        std::println(std::cout, "{}: {} = {}(def: {})", info.m_Name, info.m_Type, info.m_Value.Text(value),
+                     info.m_Default.Text(defaultValue));
+    });
+
+    std::println(std::cout, "integer via handle: {}", integer.Get());
 
     Config().SaveToFile("config.json");
     Config().ExportTemplate("config_all.json");